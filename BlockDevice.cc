@@ -0,0 +1,127 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+
+#include "config.h"
+
+// std
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// os
+#include <sys/types.h>
+#ifdef __linux__
+#include <sys/stat.h>
+#include <sys/sysmacros.h> //for major and minor
+#endif
+#ifdef HAVE_FIEMAP
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+// project
+#include "BlockDevice.hh"
+
+#ifdef __linux__
+namespace {
+// file systems like btrfs give their files an anonymous device (major 0),
+// which has no entry in /sys/dev/block. finds the block device the file
+// system is mounted from instead, or gives device back if there is none
+// (network and virtual file systems).
+dev_t
+mountsource(dev_t device)
+{
+  const std::string wanted =
+    std::to_string(major(device)) + ":" + std::to_string(minor(device));
+  // the lines look like
+  // 36 35 0:30 / /home rw,relatime shared:1 - btrfs /dev/sda2 rw,ssd
+  std::ifstream in("/proc/self/mountinfo");
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string id, parent, majorminor;
+    if (!(fields >> id >> parent >> majorminor) || majorminor != wanted) {
+      continue;
+    }
+    const auto separator = line.find(" - ");
+    if (separator == std::string::npos) {
+      continue;
+    }
+    std::istringstream rest(line.substr(separator + 3));
+    std::string fstype, source;
+    struct stat info;
+    if (rest >> fstype >> source && stat(source.c_str(), &info) == 0 &&
+        S_ISBLK(info.st_mode)) {
+      return info.st_rdev;
+    }
+  }
+  return device;
+}
+} // namespace
+#endif
+
+bool
+isrotational(dev_t device)
+{
+#ifdef __linux__
+  if (major(device) == 0) {
+    device = mountsource(device);
+  }
+  const std::string dir = "/sys/dev/block/" + std::to_string(major(device)) +
+                          ":" + std::to_string(minor(device));
+  // a disk has the queue directory, a partition has it in its parent
+  for (const char* queue : { "/queue/rotational", "/../queue/rotational" }) {
+    std::ifstream in(dir + queue);
+    char flag{};
+    if (in >> flag) {
+      return flag == '1';
+    }
+  }
+#else
+  (void)device;
+#endif
+  return false;
+}
+
+bool
+firstextent(const char* filename, std::uint64_t& physical)
+{
+#ifdef HAVE_FIEMAP
+  const int fd = open(filename, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+  if (fd < 0) {
+    return false;
+  }
+  // room for the request and one extent
+  alignas(fiemap) unsigned char
+    buffer[sizeof(fiemap) + sizeof(fiemap_extent)] = {};
+  auto* request = static_cast<fiemap*>(static_cast<void*>(buffer));
+  request->fm_start = 0;
+  request->fm_length = FIEMAP_MAX_OFFSET;
+  request->fm_extent_count = 1;
+  const bool ok = ioctl(fd, FS_IOC_FIEMAP, request) == 0 &&
+                  request->fm_mapped_extents == 1;
+  close(fd);
+  if (!ok) {
+    return false;
+  }
+  const fiemap_extent& extent = request->fm_extents[0];
+  constexpr auto noplace = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC |
+                           FIEMAP_EXTENT_DATA_INLINE |
+                           FIEMAP_EXTENT_NOT_ALIGNED;
+  if ((extent.fe_flags & noplace) != 0) {
+    return false;
+  }
+  physical = extent.fe_physical;
+  return true;
+#else
+  (void)filename;
+  (void)physical;
+  return false;
+#endif
+}
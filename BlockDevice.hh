@@ -0,0 +1,39 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_BLOCKDEVICE_HH_
+#define RDFIND_BLOCKDEVICE_HH_
+
+#include <cstdint>
+
+#include <sys/types.h> //for dev_t
+
+/**
+ * Tells if device (as in st_dev) is a rotating disk, as the kernel reports
+ * in /sys/dev/block/MAJOR:MINOR/queue/rotational. For a partition, the disk
+ * it is on is asked. For file systems that give their files an anonymous
+ * device (like btrfs), the device they are mounted from is looked up in
+ * /proc/self/mountinfo. For btrfs on several devices, that is one of them.
+ *
+ * Gives false if it can not be found out, which is the case for network and
+ * virtual file systems that have no block device of their own, and on other
+ * platforms than Linux.
+ */
+bool
+isrotational(dev_t device);
+
+/**
+ * Finds where the first extent of the file is on its device, in bytes from
+ * the start, using the FIEMAP ioctl. Only available if HAVE_FIEMAP is
+ * defined.
+ *
+ * @return false if it can not be found out, because the file can not be
+ * opened, the file system does not support FIEMAP, the file has no data or
+ * its data has no place of its own on the device yet (delayed allocation,
+ * inline data).
+ */
+bool
+firstextent(const char* filename, std::uint64_t& physical);
+
+#endif /* RDFIND_BLOCKDEVICE_HH_ */
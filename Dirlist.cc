@@ -7,92 +7,761 @@
 #include "config.h"
 
 // std
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <deque>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 // os
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#ifdef HAVE_GETDENTS64
+#include <sys/syscall.h>
+#endif
 
 // project
 #include "Dirlist.hh"
+#include "MinimalStat.hh"
+#include "PathFilter.hh"
 #include "RdfindDebug.hh" //debug macros
 
-static const int maxdepth = 50;
+namespace {
+// what kind of item a directory entry is
+enum class Filetype
+{
+  UNKNOWN,
+  REGULAR,
+  DIRECTORY,
+  SYMLINK,
+  OTHER
+};
 
-int
-Dirlist::walk(const std::string& dir, const int recursionlevel)
+Filetype
+typefrommode(mode_t mode)
 {
+  if (S_ISLNK(mode)) {
+    return Filetype::SYMLINK;
+  }
+  if (S_ISDIR(mode)) {
+    return Filetype::DIRECTORY;
+  }
+  if (S_ISREG(mode)) {
+    return Filetype::REGULAR;
+  }
+  return Filetype::OTHER;
+}
 
-  RDDEBUG("Now in walk with dir=" << dir.c_str() << " and recursionlevel="
-                                  << recursionlevel << std::endl);
+// uses d_type where the platform and file system provide it, to avoid an
+// lstat per entry.
+Filetype
+typefromdtype(unsigned char dtype)
+{
+#ifdef DT_UNKNOWN
+  switch (dtype) {
+    case DT_UNKNOWN:
+      return Filetype::UNKNOWN;
+    case DT_LNK:
+      return Filetype::SYMLINK;
+    case DT_DIR:
+      return Filetype::DIRECTORY;
+    case DT_REG:
+      return Filetype::REGULAR;
+    default:
+      return Filetype::OTHER;
+  }
+#else
+  (void)dtype;
+  return Filetype::UNKNOWN;
+#endif
+}
 
-  if (recursionlevel >= maxdepth) {
-    std::cerr << "recursion limit exceeded\n";
-    return -1;
+/**
+ * an open directory. entries are looked up and subdirectories opened
+ * relative to it, so the kernel does not have to resolve the full path from
+ * the root for every entry. it is shared by the tasks for its subdirectories
+ * and closed when the last of them is done.
+ */
+class DirHandle
+{
+public:
+  /// takes ownership of fd, and dirp if it is non-null (which then must
+  /// have been made from fd with fdopendir)
+  DirHandle(int fd, DIR* dirp, std::string path)
+    : m_fd(fd)
+    , m_dirp(dirp)
+    , m_path(std::move(path))
+  {
+    ++s_count;
+  }
+  DirHandle(const DirHandle&) = delete;
+  DirHandle& operator=(const DirHandle&) = delete;
+  ~DirHandle()
+  {
+    if (m_dirp) {
+      (void)closedir(m_dirp);
+    } else {
+      (void)close(m_fd);
+    }
+    --s_count;
+  }
+
+  /**
+   * true if it is ok to keep more directories open. on very deep trees, the
+   * subdirectories are instead opened through their full path, so the
+   * number of open file descriptors stays bounded.
+   */
+  static bool mayhold()
+  {
+    // leave half of the file descriptors to the rest of the program
+    static const rlim_t maxheld = [] {
+      struct rlimit limit;
+      if (getrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+          limit.rlim_cur == RLIM_INFINITY) {
+        return rlim_t{ 512 };
+      }
+      return limit.rlim_cur / 2;
+    }();
+    return static_cast<rlim_t>(s_count) < maxheld;
+  }
+
+  // null unless the directory is read with readdir
+  DIR* dirp() const { return m_dirp; }
+  int fd() const { return m_fd; }
+  // the path of the directory, as reported to the callback
+  const std::string& path() const { return m_path; }
+
+private:
+  int m_fd;
+  DIR* m_dirp;
+  std::string m_path;
+
+  static std::atomic<int> s_count;
+};
+std::atomic<int> DirHandle::s_count{ 0 };
+
+// the parts of a directory entry the walker looks at
+struct Direntry
+{
+  const char* name;
+  unsigned char type; // d_type
+  std::uint64_t ino;
+};
+
+/**
+ * lists the entries of a directory, either with readdir (if the handle has a
+ * DIR*) or by calling getdents64 directly with a large buffer. the latter
+ * needs fewer system calls on directories with very many entries, since the
+ * buffer readdir uses internally is small.
+ */
+class DirReader
+{
+public:
+  explicit DirReader(const DirHandle& dir)
+    : m_dir(dir)
+  {
+  }
+
+  /// gets the next entry. returns false at the end or on error.
+  bool next(Direntry& entry)
+  {
+    if (m_dir.dirp()) {
+      const struct dirent* dp = readdir(m_dir.dirp());
+      if (dp == nullptr) {
+        return false;
+      }
+#ifdef DT_UNKNOWN
+      entry = Direntry{ dp->d_name, dp->d_type, dp->d_ino };
+#else
+      entry = Direntry{ dp->d_name, 0, dp->d_ino };
+#endif
+      return true;
+    }
+#ifdef HAVE_GETDENTS64
+    if (m_pos >= m_end) {
+      const auto nread = syscall(SYS_getdents64,
+                                 m_dir.fd(),
+                                 buffer().data(),
+                                 buffer().size());
+      if (nread <= 0) {
+        return false;
+      }
+      m_pos = 0;
+      m_end = static_cast<std::size_t>(nread);
+    }
+    // the records have the layout of struct dirent64. copy the fixed size
+    // fields out instead of casting, the buffer is just chars.
+    const char* record = buffer().data() + m_pos;
+    ino64_t ino;
+    unsigned short reclen;
+    std::memcpy(&ino, record + offsetof(struct dirent64, d_ino), sizeof(ino));
+    std::memcpy(
+      &reclen, record + offsetof(struct dirent64, d_reclen), sizeof(reclen));
+    entry.name = record + offsetof(struct dirent64, d_name);
+    entry.type =
+      static_cast<unsigned char>(record[offsetof(struct dirent64, d_type)]);
+    entry.ino = ino;
+    m_pos += reclen;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+private:
+  const DirHandle& m_dir;
+#ifdef HAVE_GETDENTS64
+  // one buffer per thread, reused for all directories.
+  static std::vector<char>& buffer()
+  {
+    thread_local std::vector<char> buf(1 << 20);
+    return buf;
+  }
+  std::size_t m_pos = 0;
+  std::size_t m_end = 0;
+#endif
+};
+
+// avoids triggering automounts when only checking which device a directory
+// is on
+#ifdef AT_NO_AUTOMOUNT
+constexpr int NOAUTOMOUNT = AT_NO_AUTOMOUNT;
+#else
+constexpr int NOAUTOMOUNT = 0;
+#endif
+
+// a listed directory entry, and what lstat said about it if it was asked.
+// only keeps the fields minimalstatat fills in, since a directory can have
+// very many entries.
+struct Listed
+{
+  std::size_t nameoffset; // where the name starts in the name buffer
+  Filetype type;
+  bool haveinfo;
+  std::uint64_t ino;
+  mode_t mode;
+  off_t size;
+  dev_t dev;
+
+  void remember(const struct stat& info)
+  {
+    haveinfo = true;
+    mode = info.st_mode;
+    size = info.st_size;
+    dev = info.st_dev;
+    ino = info.st_ino;
+  }
+  void recall(struct stat& info) const
+  {
+    info = {};
+    info.st_mode = mode;
+    info.st_size = size;
+    info.st_dev = dev;
+    info.st_ino = ino;
+  }
+};
+
+// a directory waiting to be read. name is relative to parent, or a full
+// path if parent is null.
+struct DirTask
+{
+  std::shared_ptr<const DirHandle> parent;
+  std::string name;
+  int recursionlevel;
+};
+
+// calls f(worker, i) for each i in [0, n), spread over nworkers threads.
+template<class Function>
+void
+foreachtask(std::size_t nworkers, std::size_t n, Function f)
+{
+  nworkers = std::min(nworkers, n);
+  if (nworkers <= 1) {
+    for (std::size_t i = 0; i < n; ++i) {
+      f(0, i);
+    }
+    return;
+  }
+  std::atomic<std::size_t> nexttask{ 0 };
+  auto worker = [&](std::size_t me) {
+    for (auto i = nexttask++; i < n; i = nexttask++) {
+      f(me, i);
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(nworkers - 1);
+  for (std::size_t t = 1; t < nworkers; ++t) {
+    threads.emplace_back(worker, t);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+/**
+ * one queue of pending directories per worker. a worker pushes and pops at
+ * the back of its own queue (depth first, cache friendly) and steals from the
+ * front of the others when it runs dry, which is where the largest unexplored
+ * subtrees tend to be. a worker which finds nothing to steal sleeps until
+ * something is pushed, or all is done.
+ */
+class WorkStealingQueues
+{
+public:
+  explicit WorkStealingQueues(std::size_t nworkers)
+    : m_queues(nworkers)
+  {
+  }
+
+  void push(std::size_t worker, DirTask task)
+  {
+    // count it before it becomes visible, so pending never drops to zero
+    // while there is work left.
+    ++m_pending;
+    {
+      std::lock_guard<std::mutex> lock(m_queues[worker].mutex);
+      m_queues[worker].tasks.push_back(std::move(task));
+    }
+    // a sleeping worker either sees the task when it checks, or is woken.
+    ++m_queued;
+    if (m_sleeping > 0) {
+      std::lock_guard<std::mutex> lock(m_sleepmutex);
+      m_wakeup.notify_one();
+    }
+  }
+
+  /// gets work for the given worker, waiting for it if there is none yet.
+  /// returns false when all tasks are done.
+  bool wait(std::size_t worker, DirTask& task)
+  {
+    for (;;) {
+      if (pop(worker, task)) {
+        return true;
+      }
+      std::unique_lock<std::mutex> lock(m_sleepmutex);
+      ++m_sleeping;
+      m_wakeup.wait(lock, [this] { return m_queued > 0 || finished(); });
+      --m_sleeping;
+      if (m_queued == 0 && finished()) {
+        return false;
+      }
+    }
+  }
+
+  /// to be called when a task obtained from wait has been processed
+  void done()
+  {
+    if (--m_pending == 0) {
+      std::lock_guard<std::mutex> lock(m_sleepmutex);
+      m_wakeup.notify_all();
+    }
+  }
+
+  /// true when all tasks, including the ones being processed, are done.
+  bool finished() const { return m_pending == 0; }
+
+private:
+  /// gets work for the given worker, from its own queue or stolen.
+  bool pop(std::size_t worker, DirTask& task)
+  {
+    const auto n = m_queues.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto victim = (worker + i) % n;
+      Queue& q = m_queues[victim];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (q.tasks.empty()) {
+        continue;
+      }
+      if (victim == worker) {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+      } else {
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+      }
+      --m_queued;
+      return true;
+    }
+    return false;
   }
 
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<DirTask> tasks;
+  };
+  std::vector<Queue> m_queues;
+  // tasks pushed and not yet done, and of those the ones not yet taken
+  std::atomic<std::size_t> m_pending{ 0 };
+  std::atomic<std::size_t> m_queued{ 0 };
+  // workers waiting for a task
+  std::mutex m_sleepmutex;
+  std::condition_variable m_wakeup;
+  std::atomic<int> m_sleeping{ 0 };
+};
+} // namespace
+
+template<typename Descend>
+int
+Dirlist::readdirectory(int parentfd,
+                       const char* name,
+                       std::string path,
+                       int recursionlevel,
+                       int worker,
+                       Descend&& descend)
+{
   // open the directory
-  DIR* dirp = opendir(dir.c_str());
-  if (dirp == nullptr) {
+  int fd = openat(parentfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  DIR* dirp = nullptr;
+  if (fd >= 0 && !m_usegetdents) {
+    dirp = fdopendir(fd);
+    if (dirp == nullptr) {
+      (void)close(fd);
+      fd = -1;
+    }
+  }
+  if (fd < 0) {
     // failed to open directory
     RDDEBUG("failed to open directory" << std::endl);
     // this can be due to rights, or some other error.
-    handlepossiblefile(dir, recursionlevel);
+    handlepossiblefile(path, recursionlevel, worker);
     return 1; // it's a file (or something else)
   }
+  const auto self =
+    std::make_shared<const DirHandle>(fd, dirp, std::move(path));
+  const std::string& dir = self->path();
 
   // we opened the directory. let us read the content.
   RDDEBUG("opened directory" << std::endl);
-  struct dirent* dp{};
-  while (nullptr != (dp = readdir(dirp))) {
+  std::size_t statsavoided = 0;
+
+  // first list all entries, then stat the ones that need it in inode order
+  // and last act on them in the order they were listed. file systems which
+  // hash their directories (like ext4) list entries in random order
+  // relative to the inode table, so stat'ing in listing order makes the
+  // disk seek back and forth.
+  std::string names;
+  std::vector<Listed> listed;
+  DirReader reader(*self);
+  Direntry entry{};
+  while (reader.next(entry)) {
+    const char* const entryname = entry.name;
     // is the directory . or ..?
-    if (0 == strcmp(".", dp->d_name) || 0 == strcmp("..", dp->d_name)) {
+    if (0 == strcmp(".", entryname) || 0 == strcmp("..", entryname)) {
+      continue;
+    }
+
+    // apply -include/-exclude on the name, before anything is asked about
+    // the entry. excluded directories are never opened.
+    if (m_pathfilter && !m_pathfilter->accepts(dir, entryname)) {
       continue;
     }
-    // investigate what kind of file it is, don't follow any
-    // symlinks when doing this (lstat instead of stat).
+
+    Listed item{};
+    item.nameoffset = names.size();
+    item.type = typefromdtype(entry.type);
+    item.ino = entry.ino;
+    names.append(entryname).push_back('\0');
+    listed.push_back(item);
+  }
+
+  // investigate what kind of file each entry is. most file systems tell it
+  // directly in the directory entry, otherwise ask lstat (which does not
+  // follow symlinks). regular files are always stat'ed here, so the
+  // callback gets the information without asking the file system again.
+  std::vector<std::size_t> tostat;
+  for (std::size_t i = 0; i < listed.size(); ++i) {
+    const auto type = listed[i].type;
+    if (type == Filetype::UNKNOWN || type == Filetype::REGULAR) {
+      tostat.push_back(i);
+    } else {
+      ++statsavoided;
+    }
+  }
+  if (m_inodeorder) {
+    std::sort(tostat.begin(),
+              tostat.end(),
+              [&listed](std::size_t a, std::size_t b) {
+                return listed[a].ino < listed[b].ino;
+              });
+  }
+  for (const auto i : tostat) {
+    Listed& item = listed[i];
     struct stat info;
-    const int statval =
-      lstat((dir + "/" + std::string(dp->d_name)).c_str(), &info);
-    if (statval != 0) {
+    if (minimalstatat(
+          self->fd(), &names[item.nameoffset], &info, AT_SYMLINK_NOFOLLOW) !=
+        0) {
       // failed to do stat
+      item.type = Filetype::OTHER;
       continue;
     }
+    item.remember(info);
+  }
 
-    // investigate what kind of item it was.
-    bool dowalk = false;
+  std::vector<std::string> subdirs;
+  for (const Listed& item : listed) {
+    const char* const entryname = &names[item.nameoffset];
+    auto type = item.type;
+    struct stat info;
+    bool haveinfo = item.haveinfo;
+    if (haveinfo) {
+      item.recall(info);
+      type = typefrommode(info.st_mode);
+    }
 
-    if (S_ISLNK(info.st_mode)) {
-      // symlink
-      if (m_followsymlinks) {
-        (*m_callback)(dir, std::string(dp->d_name), recursionlevel);
-        dowalk = true;
+    if (type == Filetype::SYMLINK) {
+      if (!m_followsymlinks) {
+        continue;
       }
-    } else if (S_ISDIR(info.st_mode)) {
-      // directory
-      dowalk = true;
-    } else if (S_ISREG(info.st_mode)) {
-      // regular file
-      (*m_callback)(dir, std::string(dp->d_name), recursionlevel);
+      // find out what the symlink points to.
+      if (minimalstatat(self->fd(), entryname, &info, 0) != 0) {
+        // dangling link or similar, let the callback deal with it.
+        (*m_callback)(dir, entryname, recursionlevel, worker, nullptr);
+        continue;
+      }
+      haveinfo = true;
+      type = typefrommode(info.st_mode);
     }
 
-    // try to open directory
-    if (dowalk) {
-      walk(dir + "/" + dp->d_name, recursionlevel + 1);
+    if (type == Filetype::DIRECTORY) {
+      if (recursionlevel >= m_maxdepth) {
+        continue;
+      }
+      if (restrictsdevices()) {
+        // find out which file system it is on, without triggering an
+        // automount, and skip it before it is opened.
+        constexpr int flags = AT_SYMLINK_NOFOLLOW | NOAUTOMOUNT;
+        if (!haveinfo) {
+          // the type was known, but a stat was needed anyway
+          --statsavoided;
+          haveinfo = true;
+          if (minimalstatat(self->fd(), entryname, &info, flags) != 0) {
+            continue;
+          }
+        }
+        if (!deviceallowed(info.st_dev)) {
+          ++m_devicepruned;
+          continue;
+        }
+      }
+      if (!haveinfo && m_followsymlinks) {
+        // walkinlevels stats it, to tell if it was visited
+        --statsavoided;
+      }
+      subdirs.emplace_back(entryname);
+    } else if (type == Filetype::REGULAR && sizeallowed(info.st_size)) {
+      (*m_callback)(dir, entryname, recursionlevel, worker, &info);
     }
+  }
 
-  } // while
+  m_statsavoided += statsavoided;
 
-  // close the directory
-  (void)closedir(dirp);
+  // hand over the subdirectories last one first, so a stack visits them in
+  // the order they were listed.
+  for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it) {
+    descend(self, *it, recursionlevel + 1);
+  }
   return 2; // it's a directory
 }
 
+int
+Dirlist::walk(const std::string& dir, const int recursionlevel)
+{
+
+  RDDEBUG("Now in walk with dir=" << dir.c_str() << " and recursionlevel="
+                                  << recursionlevel << std::endl);
+
+  if (restrictsdevices()) {
+    // the device of the starting point decides which file system to stay
+    // on. if it can not be found, the walk below will complain.
+    struct stat info;
+    if (minimalstatat(AT_FDCWD, dir.c_str(), &info, 0) == 0) {
+      m_rootdevice = info.st_dev;
+      if (!deviceallowed(info.st_dev)) {
+        ++m_devicepruned;
+        return 0;
+      }
+    }
+  }
+
+  if (m_followsymlinks) {
+    m_visited.clear();
+    return walkinlevels(dir, recursionlevel);
+  }
+
+  const auto nworkers = static_cast<std::size_t>(m_nthreads);
+  WorkStealingQueues queues(nworkers);
+
+  // subdirectories are put on the queue of the worker that found them,
+  // instead of being walked recursively, so the depth is not limited by the
+  // call stack.
+  auto descender = [&queues](std::size_t me) {
+    return [&queues, me](const std::shared_ptr<const DirHandle>& parent,
+                         const std::string& subdir,
+                         int level) {
+      if (DirHandle::mayhold()) {
+        queues.push(me, DirTask{ parent, subdir, level });
+      } else {
+        queues.push(me,
+                    DirTask{ nullptr, parent->path() + "/" + subdir, level });
+      }
+    };
+  };
+
+  // the root is read by this thread, so the workers have something to steal
+  // when they start.
+  const int ret =
+    readdirectory(AT_FDCWD, dir.c_str(), dir, recursionlevel, 0, descender(0));
+
+  auto worker = [&](std::size_t me) {
+    DirTask task;
+    while (queues.wait(me, task)) {
+      if (task.parent) {
+        readdirectory(task.parent->fd(),
+                      task.name.c_str(),
+                      task.parent->path() + "/" + task.name,
+                      task.recursionlevel,
+                      static_cast<int>(me),
+                      descender(me));
+      } else {
+        readdirectory(AT_FDCWD,
+                      task.name.c_str(),
+                      task.name,
+                      task.recursionlevel,
+                      static_cast<int>(me),
+                      descender(me));
+      }
+      // let go of the parent directory as soon as possible
+      task.parent.reset();
+      queues.done();
+    }
+  };
+
+  if (queues.finished()) {
+    return ret;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(nworkers - 1);
+  for (std::size_t i = 1; i < nworkers; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto& t : threads) {
+    t.join();
+  }
+  return ret;
+}
+
+int
+Dirlist::walkinlevels(const std::string& dir, const int recursionlevel)
+{
+  const auto nworkers = static_cast<std::size_t>(m_nthreads);
+  int ret = 0;
+  bool atroot = true;
+  std::vector<DirTask> level{ DirTask{ nullptr, dir, recursionlevel } };
+  while (!level.empty()) {
+    const std::size_t n = level.size();
+
+    // find out which directory each task leads to
+    std::vector<std::string> paths(n);
+    std::vector<std::pair<dev_t, ino_t>> ids(n);
+    std::vector<char> known(n);
+    foreachtask(nworkers, n, [&](std::size_t, std::size_t i) {
+      const DirTask& task = level[i];
+      const int parentfd = task.parent ? task.parent->fd() : AT_FDCWD;
+      paths[i] =
+        task.parent ? task.parent->path() + "/" + task.name : task.name;
+      struct stat info;
+      if (minimalstatat(parentfd, task.name.c_str(), &info, 0) == 0) {
+        ids[i] = { info.st_dev, info.st_ino };
+        known[i] = 1;
+      }
+    });
+
+    // claim them in path order. if the directory can not be identified,
+    // read it rather than lose it.
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(),
+              order.end(),
+              [&paths](std::size_t a, std::size_t b) {
+                return paths[a] < paths[b];
+              });
+    std::vector<char> enter(n, 1);
+    for (const auto i : order) {
+      if (known[i] && !m_visited.insert(ids[i]).second) {
+        enter[i] = 0;
+        ++m_revisitspruned;
+      }
+    }
+
+    // read the claimed ones, and collect the next level
+    std::vector<std::vector<DirTask>> next(nworkers);
+    foreachtask(nworkers, n, [&](std::size_t me, std::size_t i) {
+      if (!enter[i]) {
+        return;
+      }
+      auto descend = [&next, me](
+                       const std::shared_ptr<const DirHandle>& parent,
+                       const std::string& subdir,
+                       int sublevel) {
+        if (DirHandle::mayhold()) {
+          next[me].push_back(DirTask{ parent, subdir, sublevel });
+        } else {
+          next[me].push_back(
+            DirTask{ nullptr, parent->path() + "/" + subdir, sublevel });
+        }
+      };
+      const DirTask& task = level[i];
+      const int r =
+        readdirectory(task.parent ? task.parent->fd() : AT_FDCWD,
+                      task.name.c_str(),
+                      std::move(paths[i]),
+                      task.recursionlevel,
+                      static_cast<int>(me),
+                      descend);
+      if (atroot) {
+        ret = r;
+      }
+    });
+    atroot = false;
+
+    // let go of the parent directories before the next level is read
+    level.clear();
+    for (auto& tasks : next) {
+      std::move(tasks.begin(), tasks.end(), std::back_inserter(level));
+    }
+  }
+  return ret;
+}
+
+bool
+Dirlist::deviceallowed(dev_t device) const
+{
+  if (m_onefilesystem && device != m_rootdevice) {
+    return false;
+  }
+  return std::find(m_skipdevices.begin(), m_skipdevices.end(), device) ==
+         m_skipdevices.end();
+}
+
 // splits inputstring into path and filename. if no / character is found,
 // empty string is returned as path and filename is set to inputstring.
 int
@@ -116,7 +785,9 @@ splitfilename(std::string& path,
 // this function is called for files that were believed to be directories,
 // or failed re
 int
-Dirlist::handlepossiblefile(const std::string& possiblefile, int recursionlevel)
+Dirlist::handlepossiblefile(const std::string& possiblefile,
+                            int recursionlevel,
+                            int worker)
 {
 
   RDDEBUG("Now in handlepossiblefile with name "
@@ -131,11 +802,9 @@ Dirlist::handlepossiblefile(const std::string& possiblefile, int recursionlevel)
                                     << filename.c_str() << std::endl);
 
   // investigate what kind of file it is, don't follow symlink
-  int statval = 0;
   struct stat info;
-  do {
-    statval = lstat(possiblefile.c_str(), &info);
-  } while (statval < 0 && errno == EINTR);
+  const int statval = minimalstatat(
+    AT_FDCWD, possiblefile.c_str(), &info, AT_SYMLINK_NOFOLLOW);
 
   if (statval < 0) {
     // probably file does not exist, or trouble with rights.
@@ -149,7 +818,11 @@ Dirlist::handlepossiblefile(const std::string& possiblefile, int recursionlevel)
   if (S_ISLNK(info.st_mode)) {
     RDDEBUG("found symlink" << std::endl);
     if (m_followsymlinks) {
-      (*m_callback)(path, filename, recursionlevel);
+      if (minimalstatat(AT_FDCWD, possiblefile.c_str(), &info, 0) != 0) {
+        (*m_callback)(path, filename, recursionlevel, worker, nullptr);
+      } else if (S_ISREG(info.st_mode) && sizeallowed(info.st_size)) {
+        (*m_callback)(path, filename, recursionlevel, worker, &info);
+      }
     }
     return 0;
   } else {
@@ -171,7 +844,9 @@ Dirlist::handlepossiblefile(const std::string& possiblefile, int recursionlevel)
 
   if (S_ISREG(info.st_mode)) {
     RDDEBUG("it is a regular file" << std::endl);
-    (*m_callback)(path, filename, recursionlevel);
+    if (sizeallowed(info.st_size)) {
+      (*m_callback)(path, filename, recursionlevel, worker, &info);
+    }
     return 0;
   } else {
     RDDEBUG("not a regular file" << std::endl);
@@ -7,15 +7,27 @@
 #ifndef Dirlist_hh
 #define Dirlist_hh
 
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h> //for dev_t and off_t
+
+class PathFilter;
+struct stat;
 
 /// class that traverses a directory
 class Dirlist
 {
 public:
   // constructor
-  explicit Dirlist(bool followsymlinks)
+  explicit Dirlist(bool followsymlinks, int nthreads = 1)
     : m_followsymlinks(followsymlinks)
+    , m_nthreads(nthreads)
     , m_callback(nullptr)
   {
   }
@@ -24,24 +36,157 @@ private:
   // follow symlinks or not
   bool m_followsymlinks;
 
-  // where to report found files. this is called for every item in all
-  // directories found by walk.
-  typedef int (*reportfcntype)(const std::string&, const std::string&, int);
+  // number of threads to traverse with
+  int m_nthreads;
+
+  // how many levels below the starting point to descend
+  int m_maxdepth = std::numeric_limits<int>::max();
+
+  // read directories with getdents64 instead of readdir
+  bool m_usegetdents = false;
+
+  // lstat the entries of a directory in inode order instead of listing order
+  bool m_inodeorder = true;
+
+  // do not descend into directories on another device than the starting
+  // point, or on one of m_skipdevices.
+  bool m_onefilesystem = false;
+  std::vector<dev_t> m_skipdevices;
+
+  // the device of the starting point of the current walk
+  dev_t m_rootdevice{};
+
+  // how many directories were not entered because of their device
+  std::atomic<std::size_t> m_devicepruned{ 0 };
+
+  // the directories entered so far in the current walk, by (device, inode).
+  // only kept when following symlinks, where the same directory can be
+  // reached by several paths (or in a loop).
+  std::set<std::pair<dev_t, ino_t>> m_visited;
+
+  // how many directories were not entered again because they were visited
+  std::atomic<std::size_t> m_revisitspruned{ 0 };
+
+  // decides which entries to skip by name, may be null
+  const PathFilter* m_pathfilter = nullptr;
+
+  // only files with size in [m_minsize,m_maxsize) are reported
+  off_t m_minsize = 0;
+  off_t m_maxsize = std::numeric_limits<off_t>::max();
+
+  bool sizeallowed(off_t size) const
+  {
+    return size >= m_minsize && size < m_maxsize;
+  }
+
+  bool restrictsdevices() const
+  {
+    return m_onefilesystem || !m_skipdevices.empty();
+  }
+  bool deviceallowed(dev_t device) const;
+
+  // where to report found files. this is called for every regular file in
+  // all directories found by walk that passes the size limits, with
+  // (path, name, depth, worker, info).
+  // worker is the index of the thread (0...nthreads-1) that found the item.
+  // when walking with several threads, the callback is invoked concurrently
+  // from different workers. info is what stat() gives for the file (so
+  // symlinks are resolved), or null if a followed symlink could not be
+  // resolved.
+  typedef int (*reportfcntype)(const std::string&,
+                               const std::string&,
+                               int,
+                               int,
+                               const struct stat*);
 
-  // called when a regular file or a symlink is encountered
+  // called when a regular file or a followed symlink is encountered
   reportfcntype m_callback;
 
+  // how many lstat calls were not needed, because readdir told the type
+  std::atomic<std::size_t> m_statsavoided{ 0 };
+
   // a function that is called from walk when a non-directory is encountered
   // for instance,if walk("/path/to/a/file.ext") is called instead of
   // walk("/path/to/a/")
-  int handlepossiblefile(const std::string& possiblefile, int recursionlevel);
+  int handlepossiblefile(const std::string& possiblefile,
+                         int recursionlevel,
+                         int worker);
+
+  // opens the directory name, relative to the open directory parentfd (or
+  // AT_FDCWD), reads its content and reports files to the callback. path is
+  // the name of the directory as shown to the callback. invokes
+  // descend(handle,subdirname,recursionlevel) for each subdirectory (in
+  // reverse order), where handle keeps the directory open for subdirname to
+  // be opened relative to.
+  template<typename Descend>
+  int readdirectory(int parentfd,
+                    const char* name,
+                    std::string path,
+                    int recursionlevel,
+                    int worker,
+                    Descend&& descend);
+
+  // walks one level at a time, used when following symlinks. all
+  // directories of a level are looked at before any of them is entered, so
+  // a directory reached by several paths is entered through the least deep
+  // one, and of those the first in byte order. the threads only decide who
+  // does the work, not which path is kept.
+  int walkinlevels(const std::string& dir, int recursionlevel);
 
 public:
-  // find all files on a specific place
+  // find all files on a specific place. the directories are walked by
+  // m_nthreads workers, which steal subdirectories from each other (or level
+  // by level, when following symlinks).
   int walk(const std::string& dir, const int recursionlevel = 0);
 
+  // do not descend further than maxdepth levels below the starting point
+  void setmaxdepth(int maxdepth) { m_maxdepth = maxdepth; }
+
+  // list directory content with getdents64 and a large buffer, instead of
+  // readdir. only has effect if HAVE_GETDENTS64 is defined.
+  void setusegetdents(bool usegetdents) { m_usegetdents = usegetdents; }
+
+  // lstat directory entries in inode order (the default), which is faster on
+  // rotating disks, or in the order they are listed.
+  void setinodeorder(bool inodeorder) { m_inodeorder = inodeorder; }
+
+  // only report files with size in [minsize,maxsize). this is checked on
+  // the information the walker already has, before anything is allocated
+  // for the file.
+  void setsizelimits(off_t minsize, off_t maxsize)
+  {
+    m_minsize = minsize;
+    m_maxsize = maxsize;
+  }
+
+  // skip entries the filter does not accept. the filter must outlive the
+  // walk.
+  void setpathfilter(const PathFilter* filter) { m_pathfilter = filter; }
+
+  // stay on the file system of the starting point
+  void setonefilesystem(bool onefilesystem) { m_onefilesystem = onefilesystem; }
+
+  // never enter directories on these devices
+  void setskipdevices(std::vector<dev_t> devices)
+  {
+    m_skipdevices = std::move(devices);
+  }
+
   // to set the report functions
   void setcallbackfcn(reportfcntype reportfcn) { m_callback = reportfcn; }
+
+  // the number of workers, the callback will see worker indices below this.
+  int nworkers() const { return m_nthreads; }
+
+  // the number of lstat calls avoided so far thanks to d_type
+  std::size_t statsavoided() const { return m_statsavoided; }
+
+  // the number of directories skipped so far because of their device
+  std::size_t devicepruned() const { return m_devicepruned; }
+
+  // the number of directories skipped so far because they were already
+  // walked through another path. only happens when following symlinks.
+  std::size_t revisitspruned() const { return m_revisitspruned; }
 };
 
 #endif
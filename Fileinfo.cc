@@ -7,102 +7,155 @@
 #include "config.h"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cerrno>   //for errno
 #include <cstring>  //for strerror
-#include <fstream>  //for file reading
 #include <iostream> //for cout etc
 
 // os
+#include <fcntl.h>    //for AT_FDCWD, open and posix_fadvise
 #include <sys/stat.h> //for file info
 #include <unistd.h>   //for unlink etc.
 
 // project
 #include "Checksum.hh" //checksum calculation
 #include "Fileinfo.hh"
+#include "MinimalStat.hh"
 #include "Options.hh"
 #include "UndoableUnlink.hh"
 
+namespace {
+// opens filename for reading. the access time is left as is where the kernel
+// allows it, which is for files owned by the caller (or for root).
+int
+openforreading(const char* filename)
+{
+  const int flags = O_RDONLY | O_NOCTTY | O_CLOEXEC;
+#ifdef O_NOATIME
+  const int fd = open(filename, flags | O_NOATIME);
+  if (fd >= 0 || errno != EPERM) {
+    return fd;
+  }
+#endif
+  return open(filename, flags);
+}
+} // namespace
+
 int
 Fileinfo::fillwithbytes(enum readtobuffermode filltype,
                         enum readtobuffermode lasttype,
                         std::vector<char>& buffer,
                         Checksum& chk,
-                        const Options& options)
+                        const Options& options,
+                        unsigned char* digest)
 {
   const auto filesize = this->size();
-  const auto ufilesize = static_cast<std::uint64_t>(filesize);
-  // we might already have checksummed the entire file in the previous step, if
-  // it was smaller than the buffer.
-  if (chk.getType() == options.checksum_for_firstlast_bytes) {
-    if (lasttype == readtobuffermode::READ_FIRST_BYTES &&
-        options.first_bytes_size >= ufilesize) {
-      // already checksummed!
-      return 0;
-    }
-    if (lasttype == readtobuffermode::READ_LAST_BYTES &&
-        options.last_bytes_size >= ufilesize) {
-      // already checksummed!
-      return 0;
-    }
+  if (alreadychecksummed(lasttype, chk.getType(), options)) {
+    return 0;
   }
 
-  std::fstream f1;
-  f1.open(m_filename, std::ios_base::in);
-  if (!f1.is_open()) {
-    std::cerr << "fillwithbytes.cc: Could not open file \"" << m_filename
+  const std::string filename = name();
+  const int fd = openforreading(filename.c_str());
+  if (fd < 0) {
+    std::cerr << "fillwithbytes.cc: Could not open file \"" << filename
               << "\"" << std::endl;
     return -1;
   }
 
   bool read_entire_file = true;
-  std::streamsize bytes_to_read{};
+  std::uint64_t bytes_to_read{};
+  off_t offset = 0;
   if (filltype == readtobuffermode::READ_FIRST_BYTES) {
-    bytes_to_read = static_cast<std::streamsize>(options.first_bytes_size);
-    if (filesize > bytes_to_read) {
+    bytes_to_read = options.first_bytes_size;
+    if (static_cast<std::uint64_t>(filesize) > bytes_to_read) {
       read_entire_file = false;
     }
   } else if (filltype == readtobuffermode::READ_LAST_BYTES) {
-    bytes_to_read = static_cast<std::streamsize>(options.last_bytes_size);
-    if (filesize > bytes_to_read) {
+    bytes_to_read = options.last_bytes_size;
+    if (static_cast<std::uint64_t>(filesize) > bytes_to_read) {
       read_entire_file = false;
-      f1.seekg(-static_cast<std::ofstream::off_type>(options.last_bytes_size),
-               std::ios_base::end);
+      offset = filesize - static_cast<off_t>(bytes_to_read);
     }
   }
+  const off_t start = offset;
 
-  // set memory to zero
-  m_somebytes.fill('\0');
+#ifdef HAVE_POSIX_FADVISE
+  // the range is read once from start to end, a length of zero means to the
+  // end of the file
+  posix_fadvise(fd,
+                start,
+                read_entire_file ? 0 : static_cast<off_t>(bytes_to_read),
+                POSIX_FADV_SEQUENTIAL);
+#endif
 
   // ensure the checksum object is in a good state
   chk.reset();
 
-  if (read_entire_file) {
-    while (f1) {
-      f1.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-      // gcount is never negative, the cast is safe.
-      chk.update(static_cast<std::size_t>(f1.gcount()), buffer.data());
+  // read until end of file, or until bytes_to_read is used up. a read error
+  // ends the checksum where it is, like end of file does.
+  for (;;) {
+    std::size_t length = buffer.size();
+    if (!read_entire_file) {
+      if (bytes_to_read == 0) {
+        break;
+      }
+      length = static_cast<std::size_t>(
+        std::min<std::uint64_t>(length, bytes_to_read));
     }
-  } else {
-    const auto bufsize = static_cast<std::streamsize>(buffer.size());
-    while (f1 && bytes_to_read > 0) {
-      f1.read(buffer.data(), std::min(bufsize, bytes_to_read));
-      // gcount is never negative, the cast is safe.
-      bytes_to_read -= f1.gcount();
-      chk.update(static_cast<std::size_t>(f1.gcount()), buffer.data());
+    const ssize_t nread = pread(fd, buffer.data(), length, offset);
+    if (nread < 0 && errno == EINTR) {
+      continue;
+    }
+    if (nread <= 0) {
+      break;
     }
+    chk.update(static_cast<std::size_t>(nread), buffer.data());
+    offset += nread;
+    if (!read_entire_file) {
+      bytes_to_read -= static_cast<std::uint64_t>(nread);
+    }
+  }
+
+#ifdef HAVE_POSIX_FADVISE
+  // the content is not needed again, drop it from the page cache so it does
+  // not push out what other programs are using
+  if (offset > start) {
+    posix_fadvise(fd, start, offset - start, POSIX_FADV_DONTNEED);
   }
+#endif
+  close(fd);
 
-  // store the result of the checksum calculation in somebytes
+  // store the result of the checksum calculation
   assert(chk.getDigestLength() > 0);
-  assert(static_cast<std::size_t>(chk.getDigestLength()) <= m_somebytes.size());
-  if (chk.printToBuffer(m_somebytes.data(), m_somebytes.size())) {
+  const auto digestlength = static_cast<std::size_t>(chk.getDigestLength());
+  if (chk.printToBuffer(digest, digestlength)) {
     std::cerr << "failed writing digest to buffer!!" << std::endl;
   }
 
   return 0;
 }
 
+bool
+Fileinfo::alreadychecksummed(enum readtobuffermode lasttype,
+                             checksumtypes cktype,
+                             const Options& options) const
+{
+  // we might already have checksummed the entire file in the previous step,
+  // if it was smaller than the buffer.
+  if (cktype != options.checksum_for_firstlast_bytes) {
+    return false;
+  }
+  const auto ufilesize = static_cast<std::uint64_t>(size());
+  if (lasttype == readtobuffermode::READ_FIRST_BYTES) {
+    return options.first_bytes_size >= ufilesize;
+  }
+  if (lasttype == readtobuffermode::READ_LAST_BYTES) {
+    return options.last_bytes_size >= ufilesize;
+  }
+  return false;
+}
+
 bool
 Fileinfo::readfileinfo()
 {
@@ -110,10 +163,8 @@ Fileinfo::readfileinfo()
   m_info.is_file = false;
   m_info.is_directory = false;
 
-  int res;
-  do {
-    res = stat(m_filename.c_str(), &info);
-  } while (res < 0 && errno == EINTR);
+  const std::string filename = name();
+  const int res = minimalstatat(AT_FDCWD, filename.c_str(), &info, 0);
 
   if (res < 0) {
     m_info.stat_size = 0;
@@ -121,10 +172,17 @@ Fileinfo::readfileinfo()
     m_info.stat_dev = 0;
     std::cerr << "readfileinfo.cc:Something went wrong when reading file "
                  "info from \""
-              << m_filename << "\" :" << std::strerror(errno) << std::endl;
+              << filename << "\" :" << std::strerror(errno) << std::endl;
     return false;
   }
 
+  setfileinfo(info);
+  return true;
+}
+
+void
+Fileinfo::setfileinfo(const struct stat& info)
+{
   // only keep the relevant information
   m_info.stat_size = info.st_size;
   m_info.stat_ino = info.st_ino;
@@ -132,7 +190,6 @@ Fileinfo::readfileinfo()
 
   m_info.is_file = S_ISREG(info.st_mode);
   m_info.is_directory = S_ISDIR(info.st_mode);
-  return true;
 }
 
 const char*
@@ -7,7 +7,6 @@
 #ifndef Fileinfo_hh
 #define Fileinfo_hh
 
-#include <array>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -15,8 +14,12 @@
 // os specific headers
 #include <sys/types.h> //for off_t and others.
 
+#include "ChecksumTypes.hh"
+#include "PathStore.hh"
+
 class Checksum;
 struct Options;
+struct stat;
 
 /**
  Holds information about a file.
@@ -26,17 +29,26 @@ struct Options;
 class Fileinfo
 {
 public:
-  // constructor
-  Fileinfo(std::string name, int cmdline_index, int depth)
+  // constructor. the name is put in the first shard of the global path
+  // store, so this may not be used by other threads than the main one
+  // while files are found.
+  Fileinfo(const std::string& name, int cmdline_index, int depth)
+    : Fileinfo(PathStore::global().add(0, std::string(), name),
+               cmdline_index,
+               depth)
+  {
+  }
+
+  // constructor, for a name already in the global path store
+  Fileinfo(PathStore::Ref name, int cmdline_index, int depth)
     : m_info()
-    , m_filename(std::move(name))
+    , m_name(name)
     , m_delete(false)
     , m_duptype(duptype::DUPTYPE_UNKNOWN)
     , m_cmdline_index(cmdline_index)
     , m_depth(depth)
     , m_identity(0)
   {
-    m_somebytes.fill('\0');
   }
 
   /// for storing file size in bytes, defined in sys/types.h
@@ -81,6 +93,10 @@ public:
    */
   bool readfileinfo();
 
+  /// sets the info about the file from what stat() returned, as an
+  /// alternative to readfileinfo() when stat has already been called.
+  void setfileinfo(const struct stat& info);
+
   duptype getduptype() const { return m_duptype; }
 
   /// makes a symlink of "this" that points to A.
@@ -125,8 +141,14 @@ public:
   // returns the device
   unsigned long device() const { return m_info.stat_dev; }
 
-  // gets the filename
-  const std::string& name() const { return m_filename; }
+  // gets the filename, including path
+  std::string name() const { return PathStore::global().name(m_name); }
+
+  // compares the filenames, like std::string::compare
+  int comparename(const Fileinfo& other) const
+  {
+    return PathStore::global().compare(m_name, other.m_name);
+  }
 
   // gets the command line index this item was found at
   int get_cmdline_index() const { return m_cmdline_index; }
@@ -135,25 +157,33 @@ public:
   int depth() const { return m_depth; }
 
   /**
-   * fills with bytes from the file. if lasttype is supplied,
+   * calculates the checksum of bytes from the file. if lasttype is supplied,
    * it is used to see if the file needs to be read again - useful if the file
    * is shorter than the length of the bytes field.
    * @param filltype
    * @param lasttype
    * @param buffer will be used as a scratch buffer - provided from the outside
    * to avoid having to reallocate it for each file
+   * @param digest where to put the checksum, cksum.getDigestLength() bytes.
+   * it is left as is if the file does not need to be read again, or can not
+   * be opened.
    * @return zero on success
    */
   int fillwithbytes(enum readtobuffermode filltype,
                     enum readtobuffermode lasttype,
                     std::vector<char>& buffer,
                     Checksum& cksum,
-                    const Options& options);
-
-  /// get a pointer to the bytes read from the file
-  const char* getbyteptr() const { return m_somebytes.data(); }
+                    const Options& options,
+                    unsigned char* digest);
 
-  std::size_t getbuffersize() const { return m_somebytes.size(); }
+  /**
+   * true if the checksum made in the lasttype stage covers the entire file,
+   * so making a checksum of type cktype would give the same result and the
+   * file does not need to be read again.
+   */
+  [[gnu::pure]] bool alreadychecksummed(enum readtobuffermode lasttype,
+                                        checksumtypes cktype,
+                                        const Options& options) const;
 
   /// returns true if file is a regular file. call readfileinfo first!
   bool isRegularFile() const { return m_info.is_file; }
@@ -174,8 +204,8 @@ private:
   };
   Fileinfostat m_info;
 
-  // to keep the name of the file, including path
-  std::string m_filename;
+  // the name of the file, including path, kept in the global path store
+  PathStore::Ref m_name;
 
   // to be deleted or not
   bool m_delete;
@@ -203,11 +233,6 @@ private:
    * a number to identify this individual file. used for ranking.
    */
   std::int64_t m_identity;
-
-  static constexpr int SomeByteSize = 64;
-
-  /// a buffer that will be filled with some bytes of the file or a hash
-  std::array<char, SomeByteSize> m_somebytes;
 };
 
 #endif
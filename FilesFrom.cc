@@ -0,0 +1,92 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+
+#include "config.h"
+
+// std
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// os
+#include <sys/stat.h>
+
+// project
+#include "FilesFrom.hh"
+#include "Options.hh"
+
+namespace {
+// parses "size device inode name". returns false if malformed.
+bool
+parsemetarecord(const std::string& record,
+                struct stat& info,
+                std::string& name)
+{
+  std::istringstream iss(record);
+  long long size = -1;
+  unsigned long long device{};
+  unsigned long long inode{};
+  if (!(iss >> size >> device >> inode) || size < 0 || iss.get() != ' ') {
+    return false;
+  }
+  // the name is the rest of the record, it may contain spaces.
+  std::getline(iss, name, '\0');
+  if (name.empty()) {
+    return false;
+  }
+  info = {};
+  info.st_mode = S_IFREG;
+  info.st_size = static_cast<off_t>(size);
+  info.st_dev = static_cast<dev_t>(device);
+  info.st_ino = static_cast<ino_t>(inode);
+  return true;
+}
+} // namespace
+
+std::size_t
+readfilesfrom(std::istream& in,
+              int cmdline_index,
+              const Options& options,
+              std::vector<Fileinfo>& list)
+{
+  const char separator = options.nulseparated ? '\0' : '\n';
+  const auto keep = [&](Fileinfo::filesizetype size) {
+    return size >= options.minimumfilesize && size < options.maximumfilesize;
+  };
+
+  std::size_t nbad = 0;
+  std::string record;
+  std::string name;
+  // everything in the list is at depth zero, so the order of the list is
+  // the ranking.
+  const int depth = 0;
+  while (std::getline(in, record, separator)) {
+    if (record.empty()) {
+      continue;
+    }
+    if (options.filesfrommeta) {
+      struct stat info;
+      if (!parsemetarecord(record, info, name)) {
+        std::cerr << "malformed record in file list: \"" << record << "\"\n";
+        ++nbad;
+        continue;
+      }
+      if (keep(info.st_size)) {
+        list.emplace_back(std::move(name), cmdline_index, depth);
+        list.back().setfileinfo(info);
+      }
+    } else {
+      Fileinfo tmp(record, cmdline_index, depth);
+      if (!tmp.readfileinfo()) {
+        ++nbad;
+        continue;
+      }
+      if (tmp.isRegularFile() && keep(tmp.size())) {
+        list.emplace_back(std::move(tmp));
+      }
+    }
+  }
+  return nbad;
+}
@@ -0,0 +1,39 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_FILESFROM_HH_
+#define RDFIND_FILESFROM_HH_
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+#include "Fileinfo.hh"
+
+struct Options;
+
+/**
+ * Reads a list of files instead of walking directories, for -filesfrom.
+ *
+ * Records are separated by newline, or by NUL if options.nulseparated is
+ * set. A record is a file name, or if options.filesfrommeta is set,
+ * "size device inode name" in the same format as the columns of the results
+ * file. In the latter case, the file system is not queried at all.
+ *
+ * The input is parsed as it is read, the files that pass the size limits are
+ * appended to list. Malformed records and files that can not be stat'ed are
+ * reported on std::cerr and skipped.
+ * @param in the stream to read from
+ * @param cmdline_index what to rank the files as
+ * @param options
+ * @param list where to put the files
+ * @return the number of malformed or unreadable records.
+ */
+std::size_t
+readfilesfrom(std::istream& in,
+              int cmdline_index,
+              const Options& options,
+              std::vector<Fileinfo>& list);
+
+#endif /* RDFIND_FILESFROM_HH_ */
@@ -0,0 +1,122 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_GROUPTABLE_HH_
+#define RDFIND_GROUPTABLE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * A hash table from a key to a value, for finding groups of candidates with
+ * the same size or the same device and inode without sorting them.
+ *
+ * It uses open addressing with linear probing in a single array, sized up
+ * front for the number of keys it is expected to get, so there is no
+ * allocation per key. If it gets more, the array is doubled. Nothing can be
+ * erased, and references to values are invalid after the next insert.
+ */
+template<class Key, class Value, class Hash>
+class GroupTable
+{
+public:
+  /// makes room for expectedkeys distinct keys
+  explicit GroupTable(std::size_t expectedkeys)
+  {
+    // keep the load factor at or below one half
+    std::size_t capacity = 16;
+    while (capacity < 2 * expectedkeys) {
+      capacity *= 2;
+    }
+    m_slots.resize(capacity);
+    m_mask = capacity - 1;
+  }
+
+  /**
+   * inserts value for key, unless key is already there.
+   * @return the value for key, and true if it was inserted
+   */
+  std::pair<Value&, bool> insert(const Key& key, const Value& value)
+  {
+    Slot* slot = &findslot(key);
+    if (slot->used) {
+      return { slot->value, false };
+    }
+    if (2 * (m_size + 1) > m_slots.size()) {
+      grow();
+      slot = &findslot(key);
+    }
+    ++m_size;
+    slot->used = true;
+    slot->key = key;
+    slot->value = value;
+    return { slot->value, true };
+  }
+
+  /// the value for key, or nullptr if it was not inserted
+  Value* find(const Key& key)
+  {
+    Slot& slot = findslot(key);
+    return slot.used ? &slot.value : nullptr;
+  }
+
+  /// the value for key, which must have been inserted
+  Value& at(const Key& key) { return findslot(key).value; }
+  const Value& at(const Key& key) const
+  {
+    return const_cast<GroupTable*>(this)->findslot(key).value;
+  }
+
+private:
+  struct Slot
+  {
+    Key key{};
+    Value value{};
+    bool used = false;
+  };
+  std::vector<Slot> m_slots;
+  std::size_t m_mask;
+  // the number of keys
+  std::size_t m_size = 0;
+
+  // the slot with key, or the empty slot where it belongs
+  Slot& findslot(const Key& key)
+  {
+    auto i = static_cast<std::size_t>(Hash{}(key)) & m_mask;
+    while (m_slots[i].used && !(m_slots[i].key == key)) {
+      i = (i + 1) & m_mask;
+    }
+    return m_slots[i];
+  }
+
+  // doubles the array and moves the keys over
+  void grow()
+  {
+    std::vector<Slot> old(2 * m_slots.size());
+    old.swap(m_slots);
+    m_mask = m_slots.size() - 1;
+    for (const Slot& slot : old) {
+      if (slot.used) {
+        findslot(slot.key) = slot;
+      }
+    }
+  }
+};
+
+/// spreads the bits of an integer key, for use as a hash
+inline std::uint64_t
+mixbits(std::uint64_t x)
+{
+  // the finalizer of splitmix64
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+#endif /* RDFIND_GROUPTABLE_HH_ */
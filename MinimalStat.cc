@@ -0,0 +1,80 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+
+#include "config.h"
+
+// std
+#include <atomic>
+#include <cerrno>
+
+// os
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef HAVE_STATX
+#include <sys/sysmacros.h> //for makedev
+#endif
+
+// project
+#include "MinimalStat.hh"
+
+namespace {
+int
+fallbackstatat(int dirfd, const char* pathname, struct stat* info, int flags)
+{
+  int ret;
+  do {
+    ret = fstatat(dirfd, pathname, info, flags);
+  } while (ret < 0 && errno == EINTR);
+  return ret;
+}
+
+#ifdef HAVE_STATX
+// cleared the first time statx turns out not to be usable, so it is not
+// tried again for every entry
+std::atomic<bool> statx_works{ true };
+#endif
+} // namespace
+
+int
+minimalstatat(int dirfd, const char* pathname, struct stat* info, int flags)
+{
+#ifdef HAVE_STATX
+  if (statx_works.load(std::memory_order_relaxed)) {
+    constexpr unsigned int mask = STATX_TYPE | STATX_SIZE | STATX_INO;
+    struct statx buf;
+    int ret;
+    do {
+      ret = statx(dirfd, pathname, flags | AT_STATX_DONT_SYNC, mask, &buf);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+      if (errno == ENOSYS) {
+        // the kernel does not know about statx
+        statx_works.store(false, std::memory_order_relaxed);
+      } else if (errno == EPERM || errno == EINVAL) {
+        // blocked by a seccomp filter, or not supported by an old kernel or
+        // the file system. if the old way works, statx is what fails.
+        ret = fallbackstatat(dirfd, pathname, info, flags);
+        if (ret == 0) {
+          statx_works.store(false, std::memory_order_relaxed);
+        }
+        return ret;
+      } else {
+        return ret;
+      }
+    } else if ((buf.stx_mask & mask) == mask) {
+      // the device is always filled in, it is not part of the mask.
+      info->st_mode = buf.stx_mode;
+      info->st_size = static_cast<off_t>(buf.stx_size);
+      info->st_ino = buf.stx_ino;
+      info->st_dev = makedev(buf.stx_dev_major, buf.stx_dev_minor);
+      return 0;
+    }
+    // the file system could not give what was asked for, ask the old way.
+  }
+#endif
+  return fallbackstatat(dirfd, pathname, info, flags);
+}
@@ -0,0 +1,28 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_MINIMALSTAT_HH_
+#define RDFIND_MINIMALSTAT_HH_
+
+struct stat;
+
+/**
+ * Works like fstatat(dirfd, pathname, info, flags), but only fills in what
+ * rdfind uses: the file type bits of st_mode, st_size, st_ino and st_dev.
+ * The other fields of info are unspecified.
+ *
+ * Where statx() is available, only these fields are requested and the file
+ * system is allowed to answer from cached attributes (AT_STATX_DONT_SYNC),
+ * which is cheaper on network backed and fuse file systems. It falls back to
+ * fstatat() if statx is not supported by the kernel or the file system, or
+ * is blocked (by a seccomp filter, say), and then keeps using fstatat().
+ *
+ * Interrupted calls are retried.
+ * @param flags zero, AT_SYMLINK_NOFOLLOW and/or AT_NO_AUTOMOUNT
+ * @return zero on success, otherwise -1 and errno is set.
+ */
+int
+minimalstatat(int dirfd, const char* pathname, struct stat* info, int flags);
+
+#endif /* RDFIND_MINIMALSTAT_HH_ */
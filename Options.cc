@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <sstream>
 
 #include "CmdlineParser.hh"
 #include "Options.hh"
@@ -10,6 +11,7 @@
 namespace {
 constexpr auto usagetext = R"(
 Usage: rdfind [options] FILE ...
+       rdfind [options] -filesfrom LIST [FILE ...]
 
 Finds duplicate files recursively in the given FILEs (directories), and takes
 appropriate action (by default, nothing). Directories listed first are ranked
@@ -27,6 +29,23 @@ options are (default choice within parentheses)
  -maxsize N        (N=0)          ignores files with size N bytes and larger
                                   (use 0 to disable this check).
  -followsymlinks    true |(false) follow symlinks
+ -maxdepth N                      descend at most N directory levels below
+                                  the given directories (default unlimited)
+ -onefilesystem     true |(false) do not descend into directories on other
+                                  file systems than the given directories
+ -skipdevices N[,N...]            do not descend into directories on these
+                                  devices (as listed in the results file)
+ -exclude GLOB                    skip files and directories matching GLOB
+ -include GLOB                    do not skip what matches GLOB. the first
+                                  matching -include/-exclude rule decides.
+ -excluderegex RE                 like -exclude, with a regular expression
+ -includeregex RE                 like -include, with a regular expression
+ -filesfrom LIST                  also consider the files listed in LIST,
+                                  one per line ("-" reads standard input)
+ -nulseparated      true |(false) LIST is separated by NUL, not newline
+ -filesfrommeta     true |(false) each record in LIST is
+                                  "size device inode name", the files are
+                                  then not stat'ed
  -removeidentinode (true)| false  ignore files with nonunique device and inode
 
  Processing options:
@@ -45,6 +64,22 @@ options are (default choice within parentheses)
                                   to 128 MiB.
  -deterministic    (true)| false  makes results independent of order
                                   from listing the filesystem
+ -threads N        (N=1)          number of threads to scan directories,
+                                  read files and sort large file lists with
+ -dirreader        (readdir)| getdents
+                                  how to list directory content. getdents
+                                  reads many entries per system call, which
+                                  helps on huge directories (linux only)
+ -statorder        (inode)| listing
+                                  which order to examine directory entries
+                                  in. inode order is faster on rotating
+                                  disks
+ -readorder        (inode)| extent
+                                  which order to read files in. extent
+                                  order follows where the data is on disk
+                                  (linux only)
+ -iouring          true |(false)  read first and last bytes with io_uring,
+                                  many files at once (linux only)
 
  Action options:
 
@@ -128,6 +163,48 @@ parseOptions(Parser& parser)
       o.deleteduplicates = parser.get_parsed_bool();
     } else if (parser.try_parse_bool("-followsymlinks")) {
       o.followsymlinks = parser.get_parsed_bool();
+    } else if (parser.try_parse_string("-maxdepth")) {
+      const long long maxdepth = std::stoll(parser.get_parsed_string());
+      if (maxdepth < 0) {
+        throw std::runtime_error("negative value of maxdepth not allowed");
+      }
+      o.maxdepth = static_cast<int>(
+        std::min(maxdepth,
+                 static_cast<long long>(std::numeric_limits<int>::max())));
+    } else if (parser.try_parse_bool("-onefilesystem")) {
+      o.onefilesystem = parser.get_parsed_bool();
+    } else if (parser.try_parse_string("-skipdevices")) {
+      std::istringstream iss(parser.get_parsed_string());
+      std::string device;
+      while (std::getline(iss, device, ',')) {
+        if (device.empty() ||
+            device.find_first_not_of("0123456789") != std::string::npos) {
+          std::cerr << "expected a comma separated list of device numbers, "
+                       "not \""
+                    << parser.get_parsed_string() << "\"\n";
+          std::exit(EXIT_FAILURE);
+        }
+        o.skipdevices.push_back(static_cast<dev_t>(std::stoull(device)));
+      }
+    } else if (parser.try_parse_string("-exclude")) {
+      o.pathrules.push_back(
+        PathRule{ false, false, parser.get_parsed_string() });
+    } else if (parser.try_parse_string("-include")) {
+      o.pathrules.push_back(
+        PathRule{ true, false, parser.get_parsed_string() });
+    } else if (parser.try_parse_string("-excluderegex")) {
+      o.pathrules.push_back(
+        PathRule{ false, true, parser.get_parsed_string() });
+    } else if (parser.try_parse_string("-includeregex")) {
+      o.pathrules.push_back(
+        PathRule{ true, true, parser.get_parsed_string() });
+    } else if (parser.try_parse_string("-filesfrom")) {
+      o.filesfrom = parser.get_parsed_string();
+      o.filesfrom_index = parser.get_current_index();
+    } else if (parser.try_parse_bool("-nulseparated")) {
+      o.nulseparated = parser.get_parsed_bool();
+    } else if (parser.try_parse_bool("-filesfrommeta")) {
+      o.filesfrommeta = parser.get_parsed_bool();
     } else if (parser.try_parse_bool("-dryrun")) {
       o.dryrun = parser.get_parsed_bool();
     } else if (parser.try_parse_bool("-n")) {
@@ -214,6 +291,67 @@ parseOptions(Parser& parser)
                   << nextarg << "\" is not among them.\n";
         std::exit(EXIT_FAILURE);
       }
+    } else if (parser.try_parse_string("-threads")) {
+      const long long threads = std::stoll(parser.get_parsed_string());
+      constexpr long long max_threads = 1024;
+      if (threads <= 0) {
+        std::cerr << "a negative or zero number of threads is not allowed\n";
+        std::exit(EXIT_FAILURE);
+      } else if (threads > max_threads) {
+        std::cerr << "a maximum of " << max_threads
+                  << " threads is allowed, got " << threads << "\n";
+        std::exit(EXIT_FAILURE);
+      }
+      o.threads = static_cast<int>(threads);
+    } else if (parser.try_parse_string("-statorder")) {
+      if (parser.parsed_string_is("inode")) {
+        o.inodeorder = true;
+      } else if (parser.parsed_string_is("listing")) {
+        o.inodeorder = false;
+      } else {
+        std::cerr << "expected inode/listing, not \""
+                  << parser.get_parsed_string() << "\"\n";
+        std::exit(EXIT_FAILURE);
+      }
+    } else if (parser.try_parse_string("-readorder")) {
+      if (parser.parsed_string_is("inode")) {
+        o.extentorder = false;
+      } else if (parser.parsed_string_is("extent")) {
+#ifdef HAVE_FIEMAP
+        o.extentorder = true;
+#else
+        std::cerr << "extent order is not supported on this platform\n";
+        std::exit(EXIT_FAILURE);
+#endif
+      } else {
+        std::cerr << "expected inode/extent, not \""
+                  << parser.get_parsed_string() << "\"\n";
+        std::exit(EXIT_FAILURE);
+      }
+    } else if (parser.try_parse_bool("-iouring")) {
+#ifdef HAVE_IOURING
+      o.iouring = parser.get_parsed_bool();
+#else
+      if (parser.get_parsed_bool()) {
+        std::cerr << "io_uring is not supported on this platform\n";
+        std::exit(EXIT_FAILURE);
+      }
+#endif
+    } else if (parser.try_parse_string("-dirreader")) {
+      if (parser.parsed_string_is("readdir")) {
+        o.usegetdents = false;
+      } else if (parser.parsed_string_is("getdents")) {
+#ifdef HAVE_GETDENTS64
+        o.usegetdents = true;
+#else
+        std::cerr << "getdents is not supported on this platform\n";
+        std::exit(EXIT_FAILURE);
+#endif
+      } else {
+        std::cerr << "expected readdir/getdents, not \""
+                  << parser.get_parsed_string() << "\"\n";
+        std::exit(EXIT_FAILURE);
+      }
     } else if (parser.try_parse_bool("-progress")) {
       o.showprogress = parser.get_parsed_bool();
     } else if (parser.current_arg_is("-help") || parser.current_arg_is("-h") ||
@@ -3,10 +3,13 @@
 #include "config.h"
 
 #include <cstddef>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "ChecksumTypes.hh"
 #include "Fileinfo.hh"
+#include "PathFilter.hh"
 
 class Parser;
 
@@ -22,6 +25,15 @@ struct Options
     0; // if nonzero, files this size or larger are ignored
   bool deleteduplicates = false;      // delete duplicate files
   bool followsymlinks = false;        // follow symlinks
+  int maxdepth =
+    std::numeric_limits<int>::max(); // how deep to descend into directories
+  bool onefilesystem = false; // do not cross into other file systems
+  std::vector<dev_t> skipdevices; // do not enter directories on these devices
+  std::vector<PathRule> pathrules; // -include and -exclude, in given order
+  std::string filesfrom;     // read files from this list ("-" is stdin)
+  int filesfrom_index = 0;   // command line index of -filesfrom, for ranking
+  bool nulseparated = false; // the list is NUL separated, not newline
+  bool filesfrommeta = false; // the list has size, device and inode columns
   bool dryrun = false;                // only dryrun, don't destroy anything
   bool remove_identical_inode = true; // remove files with identical inodes
   bool usemd5 = false;       // use md5 checksum to check for similarity
@@ -34,6 +46,11 @@ struct Options
   bool showprogress = false; // show progress while reading file contents
   std::size_t buffersize = 1 << 20; // chunksize to use when reading files
   long nsecsleep = 0; // number of nanoseconds to sleep between each file read.
+  int threads = 1;    // number of threads to scan, read and group files with
+  bool usegetdents = false; // list directories with getdents64, not readdir
+  bool inodeorder = true;   // lstat directory entries in inode order
+  bool extentorder = false; // read files in order of their place on disk
+  bool iouring = false;     // read first and last bytes with io_uring
   std::string resultsfile = "results.txt"; // results file name.
   std::uint64_t first_bytes_size =
     4096; // how much to read during the "read first bytes" step
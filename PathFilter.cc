@@ -0,0 +1,80 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+
+#include "config.h"
+
+// std
+#include <stdexcept>
+
+// os
+#include <fnmatch.h>
+#include <regex.h>
+
+// project
+#include "PathFilter.hh"
+
+// a compiled regular expression
+struct PathFilter::Compiled
+{
+  explicit Compiled(const std::string& pattern)
+  {
+    const int ret =
+      regcomp(&regex, pattern.c_str(), REG_EXTENDED | REG_NOSUB);
+    if (ret != 0) {
+      char message[256];
+      regerror(ret, &regex, message, sizeof(message));
+      throw std::runtime_error("bad regular expression \"" + pattern +
+                               "\": " + message);
+    }
+  }
+  Compiled(const Compiled&) = delete;
+  Compiled& operator=(const Compiled&) = delete;
+  ~Compiled() { regfree(&regex); }
+
+  regex_t regex;
+};
+
+PathFilter::PathFilter(const std::vector<PathRule>& rules)
+  : m_rules(rules.size())
+{
+  for (std::size_t i = 0; i < rules.size(); ++i) {
+    Rule& r = m_rules[i];
+    r.rule = rules[i];
+    if (r.rule.isregex) {
+      r.compiled = std::make_unique<Compiled>(r.rule.pattern);
+      r.matchesname = false;
+    } else {
+      r.matchesname = r.rule.pattern.find('/') == std::string::npos;
+    }
+    if (!r.matchesname) {
+      m_needpath = true;
+    }
+  }
+}
+
+PathFilter::~PathFilter() = default;
+
+bool
+PathFilter::matches(const Rule& r, const char* name, const char* path) const
+{
+  if (r.compiled) {
+    return regexec(&r.compiled->regex, path, 0, nullptr, 0) == 0;
+  }
+  return fnmatch(r.rule.pattern.c_str(), r.matchesname ? name : path, 0) == 0;
+}
+
+bool
+PathFilter::accepts(const std::string& dir, const char* name) const
+{
+  // only build the full path if some rule needs it
+  const std::string path = m_needpath ? dir + "/" + name : std::string();
+  for (const Rule& r : m_rules) {
+    if (matches(r, name, path.c_str())) {
+      ++r.hits;
+      return r.rule.include;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,68 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_PATHFILTER_HH_
+#define RDFIND_PATHFILTER_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// an -include or -exclude rule, as given on the command line
+struct PathRule
+{
+  bool include;     // include or exclude what matches
+  bool isregex;     // extended regular expression, otherwise a glob
+  std::string pattern;
+};
+
+/**
+ * Decides which directory entries to look at, from a list of rules that are
+ * compiled once. The rules are tried in order and the first one that matches
+ * decides. If none matches, the entry is included.
+ *
+ * A glob without a slash is matched against the name of the entry, other
+ * globs and all regular expressions are matched against the full path.
+ *
+ * Matching is thread safe.
+ */
+class PathFilter
+{
+public:
+  /// throws std::runtime_error if a regular expression is malformed.
+  explicit PathFilter(const std::vector<PathRule>& rules);
+  ~PathFilter();
+  PathFilter(const PathFilter&) = delete;
+  PathFilter& operator=(const PathFilter&) = delete;
+
+  bool empty() const { return m_rules.empty(); }
+
+  /**
+   * true if the entry name in directory dir should be looked at.
+   */
+  bool accepts(const std::string& dir, const char* name) const;
+
+  std::size_t size() const { return m_rules.size(); }
+  const PathRule& rule(std::size_t i) const { return m_rules[i].rule; }
+  /// how many entries rule i decided on so far
+  std::size_t hits(std::size_t i) const { return m_rules[i].hits; }
+
+private:
+  struct Compiled;
+  struct Rule
+  {
+    PathRule rule;
+    bool matchesname; // match the name only, not the full path
+    std::unique_ptr<Compiled> compiled;
+    mutable std::atomic<std::size_t> hits{ 0 };
+  };
+  std::vector<Rule> m_rules;
+  bool m_needpath = false;
+
+  bool matches(const Rule& r, const char* name, const char* path) const;
+};
+
+#endif /* RDFIND_PATHFILTER_HH_ */
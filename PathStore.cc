@@ -0,0 +1,310 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+
+#include "config.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+// project
+#include "GroupTable.hh" //for mixbits
+#include "PathStore.hh"
+
+namespace {
+// how much name storage to allocate at a time. longer names get a chunk of
+// their own.
+constexpr std::size_t ChunkSize = 1 << 20;
+
+std::uint64_t
+hashname(std::uint32_t parent, const char* name, std::size_t length)
+{
+  // fnv-1a over the name, then mixed with the parent
+  std::uint64_t h = 0xcbf29ce484222325ULL;
+  for (std::size_t i = 0; i < length; ++i) {
+    h ^= static_cast<unsigned char>(name[i]);
+    h *= 0x100000001b3ULL;
+  }
+  return mixbits(h ^ parent);
+}
+} // namespace
+
+struct PathStore::Shard
+{
+  // a directory: the one it is in, and where its own name is
+  struct Dir
+  {
+    std::uint32_t parent;
+    std::uint32_t chunk;
+    std::uint32_t pos;
+    std::uint32_t length;
+  };
+
+  // index 0 is no directory at all, the others have a parent with a lower
+  // index
+  std::vector<Dir> dirs{ Dir{} };
+  // finds a directory by parent and name. open addressing, holds indices in
+  // dirs with 0 for an empty slot.
+  std::vector<std::uint32_t> lookup;
+  // names of directories and files, each followed by a null character
+  std::vector<std::vector<char>> chunks;
+
+  // files are mostly reported a directory at a time, so the last one asked
+  // for is remembered
+  std::string lastdir;
+  std::uint32_t lastid = 0;
+
+  const char* text(std::uint32_t chunk, std::uint32_t pos) const
+  {
+    return chunks[chunk].data() + pos;
+  }
+
+  std::uint32_t adddir(const std::string& dir)
+  {
+    if (dir == lastdir) {
+      return lastid;
+    }
+    // look up the path a component at a time, so the directories leading to
+    // it are shared with all other paths through them
+    std::uint32_t id = 0;
+    if (!dir.empty()) {
+      std::size_t begin = 0;
+      for (;;) {
+        const auto end = std::min(dir.find('/', begin), dir.size());
+        id = child(id, dir.data() + begin, end - begin);
+        if (end == dir.size()) {
+          break;
+        }
+        begin = end + 1;
+      }
+    }
+    lastdir = dir;
+    lastid = id;
+    return id;
+  }
+
+  // the directory name in parent, added if it is not there
+  std::uint32_t child(std::uint32_t parent,
+                      const char* name,
+                      std::size_t length)
+  {
+    if (2 * dirs.size() >= lookup.size()) {
+      grow();
+    }
+    const std::uint64_t mask = lookup.size() - 1;
+    auto i = hashname(parent, name, length) & mask;
+    for (; lookup[i] != 0; i = (i + 1) & mask) {
+      const Dir& d = dirs[lookup[i]];
+      if (d.parent == parent && d.length == length &&
+          std::memcmp(text(d.chunk, d.pos), name, length) == 0) {
+        return lookup[i];
+      }
+    }
+    if (dirs.size() >= std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error("too many directories");
+    }
+    const auto where = addname(name, length);
+    dirs.push_back(Dir{ parent,
+                        where.first,
+                        where.second,
+                        static_cast<std::uint32_t>(length) });
+    lookup[i] = static_cast<std::uint32_t>(dirs.size() - 1);
+    return lookup[i];
+  }
+
+  // doubles the lookup table
+  void grow()
+  {
+    lookup.assign(std::max(std::size_t{ 16 }, 2 * lookup.size()), 0);
+    const std::uint64_t mask = lookup.size() - 1;
+    for (std::size_t id = 1; id < dirs.size(); ++id) {
+      const Dir& d = dirs[id];
+      auto i = hashname(d.parent, text(d.chunk, d.pos), d.length) & mask;
+      while (lookup[i] != 0) {
+        i = (i + 1) & mask;
+      }
+      lookup[i] = static_cast<std::uint32_t>(id);
+    }
+  }
+
+  // returns (chunk, pos)
+  std::pair<std::uint32_t, std::uint32_t> addname(const char* name,
+                                                  std::size_t length)
+  {
+    const auto needed = length + 1;
+    if (chunks.empty() ||
+        chunks.back().capacity() - chunks.back().size() < needed) {
+      if (chunks.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("too many names");
+      }
+      chunks.emplace_back();
+      chunks.back().reserve(std::max(ChunkSize, needed));
+    }
+    auto& chunk = chunks.back();
+    const auto pos = chunk.size();
+    chunk.insert(chunk.end(), name, name + length);
+    chunk.push_back('\0');
+    return { static_cast<std::uint32_t>(chunks.size() - 1),
+             static_cast<std::uint32_t>(pos) };
+  }
+
+  // puts the directories leading to id in chain, outermost first
+  void chain(std::uint32_t id, std::vector<std::uint32_t>& out) const
+  {
+    out.clear();
+    for (; id != 0; id = dirs[id].parent) {
+      out.push_back(id);
+    }
+    std::reverse(out.begin(), out.end());
+  }
+
+  // gives the characters of a full name one at a time, from the directory at
+  // position from in the chain on
+  class Cursor
+  {
+  public:
+    Cursor(const Shard& shard,
+           const std::vector<std::uint32_t>& chain,
+           std::size_t from,
+           const char* leaf)
+      : m_shard(shard)
+      , m_chain(chain)
+      , m_level(from)
+      , m_leaf(leaf)
+    {
+      load();
+    }
+
+    /// the next character, or -1 at the end
+    int next()
+    {
+      if (m_pos != m_end) {
+        return static_cast<unsigned char>(*m_pos++);
+      }
+      if (m_level == m_chain.size()) {
+        return -1;
+      }
+      ++m_level;
+      load();
+      return '/';
+    }
+
+  private:
+    const Shard& m_shard;
+    const std::vector<std::uint32_t>& m_chain;
+    std::size_t m_level;
+    const char* m_leaf;
+    const char* m_pos = nullptr;
+    const char* m_end = nullptr;
+
+    void load()
+    {
+      if (m_level < m_chain.size()) {
+        const auto& d = m_shard.dirs[m_chain[m_level]];
+        m_pos = m_shard.text(d.chunk, d.pos);
+        m_end = m_pos + d.length;
+      } else {
+        m_pos = m_leaf;
+        m_end = m_leaf + std::strlen(m_leaf);
+      }
+    }
+  };
+};
+
+PathStore::PathStore()
+{
+  reserveshards(1);
+}
+
+PathStore::~PathStore() = default;
+
+PathStore&
+PathStore::global()
+{
+  static PathStore store;
+  return store;
+}
+
+void
+PathStore::reserveshards(std::size_t n)
+{
+  assert(n <= std::numeric_limits<std::uint16_t>::max() + std::size_t{ 1 });
+  while (m_shards.size() < n) {
+    m_shards.emplace_back(new Shard);
+  }
+}
+
+PathStore::Ref
+PathStore::add(std::size_t shard,
+               const std::string& dir,
+               const std::string& leaf)
+{
+  assert(shard < m_shards.size());
+  Shard& s = *m_shards[shard];
+  Ref ref;
+  ref.shard = static_cast<std::uint16_t>(shard);
+  ref.dir = s.adddir(dir);
+  const auto where = s.addname(leaf.data(), leaf.size());
+  ref.chunk = where.first;
+  ref.pos = where.second;
+  return ref;
+}
+
+std::string
+PathStore::name(Ref ref) const
+{
+  const Shard& s = *m_shards[ref.shard];
+  std::vector<std::uint32_t> dirs;
+  s.chain(ref.dir, dirs);
+  std::string ret;
+  for (const auto id : dirs) {
+    const auto& d = s.dirs[id];
+    ret.append(s.text(d.chunk, d.pos), d.length).append(1, '/');
+  }
+  ret.append(s.text(ref.chunk, ref.pos));
+  return ret;
+}
+
+int
+PathStore::compare(Ref a, Ref b) const
+{
+  const Shard& sa = *m_shards[a.shard];
+  const Shard& sb = *m_shards[b.shard];
+  const char* leafa = sa.text(a.chunk, a.pos);
+  const char* leafb = sb.text(b.chunk, b.pos);
+  if (&sa == &sb && a.dir == b.dir) {
+    // the common case when sorting, files in the same directory
+    const int cmp = std::strcmp(leafa, leafb);
+    return cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+  }
+  // the directories leading to a and b. within a shard, the same directory
+  // is the same name, so the ones they have in common can be skipped.
+  thread_local std::vector<std::uint32_t> chaina;
+  thread_local std::vector<std::uint32_t> chainb;
+  sa.chain(a.dir, chaina);
+  sb.chain(b.dir, chainb);
+  std::size_t common = 0;
+  if (&sa == &sb) {
+    while (common < chaina.size() && common < chainb.size() &&
+           chaina[common] == chainb[common]) {
+      ++common;
+    }
+  }
+  Shard::Cursor ca(sa, chaina, common, leafa);
+  Shard::Cursor cb(sb, chainb, common, leafb);
+  for (;;) {
+    const int x = ca.next();
+    const int y = cb.next();
+    if (x != y) {
+      return x < y ? -1 : 1;
+    }
+    if (x < 0) {
+      return 0;
+    }
+  }
+}
@@ -0,0 +1,66 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_PATHSTORE_HH_
+#define RDFIND_PATHSTORE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Keeps the names of the found files compactly. Each directory is stored
+ * once in a directory table, as its parent directory and its own name, so
+ * the path leading to it is not repeated. The names of directories and
+ * files are packed after each other in large chunks, instead of every file
+ * having its full path in a separate allocation. Full names are put
+ * together only when they are needed.
+ *
+ * The store is split in shards, one per directory walking thread, so
+ * adding needs no locking. A shard may only be added to by one thread at a
+ * time, and only be read by other threads after that one is done with it.
+ * Names are never removed.
+ */
+class PathStore
+{
+public:
+  /// refers to a name in the store
+  struct Ref
+  {
+    std::uint32_t dir;   // index in the directory table of the shard
+    std::uint32_t chunk; // which chunk the leaf name is in
+    std::uint32_t pos;   // where in the chunk the leaf name starts
+    std::uint16_t shard;
+  };
+
+  PathStore();
+  PathStore(const PathStore&) = delete;
+  PathStore& operator=(const PathStore&) = delete;
+  ~PathStore();
+
+  /// the store the names of all Fileinfo objects are kept in
+  static PathStore& global();
+
+  /// makes sure there are at least n shards. must not be called when
+  /// anything else uses the store.
+  void reserveshards(std::size_t n);
+
+  /// adds the name dir + "/" + leaf, or just leaf if dir is empty
+  Ref add(std::size_t shard, const std::string& dir, const std::string& leaf);
+
+  /// the full name
+  std::string name(Ref ref) const;
+
+  /// compares the full names of a and b, like std::string::compare, without
+  /// putting them together
+  int compare(Ref a, Ref b) const;
+
+private:
+  struct Shard;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+#endif /* RDFIND_PATHSTORE_HH_ */
@@ -0,0 +1,99 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_RADIXSORT_HH_
+#define RDFIND_RADIXSORT_HH_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * below this many elements, radixsort() uses std::stable_sort instead. the
+ * crossover was measured with the benchmark in unittests/test_radixsort.cc,
+ * for 64 bit keys.
+ */
+constexpr std::size_t RadixSortMinSize = 2048;
+
+/**
+ * sorts the indices in [first,last) on key(index), which must return an
+ * unsigned integer. the sort is stable, so sorting on several keys is done
+ * by sorting on the least significant key first.
+ *
+ * the keys are fetched once, then sorted a byte at a time from the least
+ * significant end (LSD radix sort). bytes which are the same for all keys
+ * are skipped, so small values cost only a few passes. needs temporary
+ * memory for the keys and indices, twice over.
+ */
+template<class Iterator, class Key>
+void
+radixsort(Iterator first, Iterator last, Key key)
+{
+  using Index = typename std::iterator_traits<Iterator>::value_type;
+  using Keytype = std::decay_t<decltype(key(*first))>;
+  static_assert(std::is_unsigned_v<Keytype>, "the key must be unsigned");
+  constexpr std::size_t Nbytes = sizeof(Keytype);
+
+  const auto n = static_cast<std::size_t>(std::distance(first, last));
+  if (n < RadixSortMinSize) {
+    std::stable_sort(first, last, [&key](const Index& a, const Index& b) {
+      return key(a) < key(b);
+    });
+    return;
+  }
+
+  struct Item
+  {
+    Keytype key;
+    Index index;
+  };
+  // not value initialized, every element is written before it is read
+  std::unique_ptr<Item[]> items(new Item[n]);
+  std::unique_ptr<Item[]> scratch(new Item[n]);
+
+  // fetch the keys and count all bytes in one go
+  std::array<std::array<std::size_t, 256>, Nbytes> counts{};
+  {
+    std::size_t i = 0;
+    for (auto it = first; it != last; ++it, ++i) {
+      const Keytype k = key(*it);
+      items[i] = Item{ k, *it };
+      for (std::size_t b = 0; b < Nbytes; ++b) {
+        ++counts[b][(k >> (8 * b)) & 0xFF];
+      }
+    }
+  }
+
+  for (std::size_t b = 0; b < Nbytes; ++b) {
+    auto& count = counts[b];
+    const auto shift = 8 * b;
+    // all keys have the same byte here, nothing to do
+    if (count[(items[0].key >> shift) & 0xFF] == n) {
+      continue;
+    }
+    std::size_t offset = 0;
+    for (auto& c : count) {
+      const auto tmp = c;
+      c = offset;
+      offset += tmp;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      const Item& item = items[i];
+      scratch[count[(item.key >> shift) & 0xFF]++] = item;
+    }
+    items.swap(scratch);
+  }
+
+  std::size_t i = 0;
+  for (auto it = first; it != last; ++it, ++i) {
+    *it = items[i].index;
+  }
+}
+
+#endif /* RDFIND_RADIXSORT_HH_ */
@@ -9,20 +9,31 @@
 
 // std
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <fstream>  //for file writing
 #include <iostream> //for std::cerr
+#include <limits>
+#include <mutex>
+#include <numeric>
 #include <ostream>  //for output
+#include <stdexcept>
 #include <string>   //for easier passing of string arguments
-#include <thread>   //sleep
+#include <thread>   //sleep, and the parallel passes
+#include <tuple>
 
 // project
+#include "BlockDevice.hh"
 #include "Checksum.hh"
 #include "Fileinfo.hh" //file container
+#include "GroupTable.hh"
 #include "Options.hh"
+#include "RadixSort.hh"
 #include "RdfindDebug.hh"
+#include "UringReader.hh"
 
 // class declaration
 #include "Rdutil.hh"
@@ -193,54 +204,94 @@ Rdutil::markitems()
   for (auto& file : m_list) {
     file.setidentity(fileno++);
   }
+  buildtable();
 }
 
 namespace {
 bool
-cmpDeviceInode(const Fileinfo& a, const Fileinfo& b)
-{
-  return std::make_tuple(a.device(), a.inode()) <
-         std::make_tuple(b.device(), b.inode());
-}
-// compares rank as described in RANKING on man page.
-bool
-cmpRank(const Fileinfo& a, const Fileinfo& b)
-{
-  return std::make_tuple(a.get_cmdline_index(), a.depth(), a.getidentity()) <
-         std::make_tuple(b.get_cmdline_index(), b.depth(), b.getidentity());
-}
-bool
 cmpDepthName(const Fileinfo& a, const Fileinfo& b)
 {
-  // inefficient, make it a reference.
-  return std::make_tuple(a.depth(), a.name()) <
-         std::make_tuple(b.depth(), b.name());
+  if (a.depth() != b.depth()) {
+    return a.depth() < b.depth();
+  }
+  return a.comparename(b) < 0;
 }
-// compares buffers
-bool
-cmpBuffers(const Fileinfo& a, const Fileinfo& b)
+// reads 8 bytes as a big endian number, so numbers compare like memcmp
+std::uint64_t
+loadbigendian(const unsigned char* p)
 {
-  return std::memcmp(a.getbyteptr(), b.getbyteptr(), a.getbuffersize()) < 0;
+  std::uint64_t x = 0;
+  for (int i = 0; i < 8; ++i) {
+    x = (x << 8) | p[i];
+  }
+  return x;
 }
 
-#if !defined(NDEBUG)
-bool
-hasEqualBuffers(const Fileinfo& a, const Fileinfo& b)
+// the first eight bytes of a digest as a number, padded with zeros if it is
+// shorter. orders like memcmp on those bytes.
+std::uint64_t
+digestprefix(const unsigned char* p, std::size_t length)
 {
-  return std::memcmp(a.getbyteptr(), b.getbyteptr(), a.getbuffersize()) == 0;
+  if (length >= 8) {
+    return loadbigendian(p);
+  }
+  std::uint64_t x = 0;
+  for (std::size_t i = 0; i < 8; ++i) {
+    x = (x << 8) | (i < length ? p[i] : 0U);
+  }
+  return x;
 }
-#endif
 
-// compares file size
-bool
-cmpSize(const Fileinfo& a, const Fileinfo& b)
+// compares digests of length N like memcmp, eight bytes at a time.
+template<std::size_t N>
+struct Digestcompare
 {
-  return a.size() < b.size();
-}
-bool
-cmpSizeThenBuffer(const Fileinfo& a, const Fileinfo& b)
+  int operator()(const unsigned char* a, const unsigned char* b) const
+  {
+    for (std::size_t i = 0; i + 8 <= N; i += 8) {
+      const auto x = loadbigendian(a + i);
+      const auto y = loadbigendian(b + i);
+      if (x != y) {
+        return x < y ? -1 : 1;
+      }
+    }
+    constexpr std::size_t tail = N % 8;
+    return tail == 0 ? 0 : std::memcmp(a + N - tail, b + N - tail, tail);
+  }
+};
+
+// compares digests of any length, including none
+struct Anydigestcompare
+{
+  std::size_t length;
+  int operator()(const unsigned char* a, const unsigned char* b) const
+  {
+    return length == 0 ? 0 : std::memcmp(a, b, length);
+  }
+};
+
+// invokes callback with a function object that compares digests of the
+// given length, specialized for the lengths of the supported checksums.
+template<class Callback>
+void
+withdigestcompare(std::size_t length, Callback callback)
 {
-  return (a.size() < b.size()) || (a.size() == b.size() && cmpBuffers(a, b));
+  switch (length) {
+    case 16: // md5, xxh128
+      callback(Digestcompare<16>{});
+      break;
+    case 20: // sha1
+      callback(Digestcompare<20>{});
+      break;
+    case 32: // sha256
+      callback(Digestcompare<32>{});
+      break;
+    case 64: // sha512
+      callback(Digestcompare<64>{});
+      break;
+    default:
+      callback(Anydigestcompare{ length });
+  }
 }
 
 /**
@@ -289,13 +340,347 @@ apply_on_range(Iterator first, Iterator last, Cmp cmp, Callback callback)
     }
   }
 }
+
+// the number of candidates a GroupTable is made for. more candidates are
+// split on the hash of their key, in parts of about this size which are
+// grouped one after the other, so the table fits in the caches and needs
+// little memory next to the candidates.
+constexpr std::size_t GroupTableMaxSize = std::size_t{ 1 } << 16;
+// below this many elements, a pass runs on one thread. starting threads
+// costs more than it gains on small lists.
+constexpr std::size_t ParallelMinSize = std::size_t{ 1 } << 16;
+
+// invokes f(t) for t in 0...nthreads-1, each on a thread of its own (t=0 on
+// the calling thread), and waits for all of them.
+template<class Function>
+void
+inparallel(std::size_t nthreads, Function f)
+{
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads - 1);
+  for (std::size_t t = 1; t < nthreads; ++t) {
+    threads.emplace_back([&f, t]() { f(t); });
+  }
+  f(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// the start of piece t of n elements split into npieces
+std::size_t
+piecebegin(std::size_t n, std::size_t npieces, std::size_t t)
+{
+  return n / npieces * t + std::min(t, n % npieces);
+}
+
+/**
+ * like std::stable_sort, with nthreads threads. each thread sorts a piece,
+ * then the pieces are merged pairwise. both steps are stable, so the result
+ * does not depend on nthreads.
+ */
+template<class Iterator, class Cmp>
+void
+parallelstablesort(Iterator first, Iterator last, std::size_t nthreads, Cmp cmp)
+{
+  const auto n = static_cast<std::size_t>(last - first);
+  std::vector<std::ptrdiff_t> bounds(nthreads + 1);
+  for (std::size_t t = 0; t <= nthreads; ++t) {
+    bounds[t] = static_cast<std::ptrdiff_t>(piecebegin(n, nthreads, t));
+  }
+  inparallel(nthreads, [&](std::size_t t) {
+    std::stable_sort(first + bounds[t], first + bounds[t + 1], cmp);
+  });
+  for (std::size_t width = 1; width < nthreads; width *= 2) {
+    const auto nmerges = (nthreads + 2 * width - 1) / (2 * width);
+    inparallel(nmerges, [&](std::size_t m) {
+      const auto lo = 2 * width * m;
+      const auto mid = std::min(lo + width, nthreads);
+      const auto hi = std::min(lo + 2 * width, nthreads);
+      std::inplace_merge(
+        first + bounds[lo], first + bounds[mid], first + bounds[hi], cmp);
+    });
+  }
+}
+
+/**
+ * splits the indices in [first,last) into nshards lists, index i going to
+ * list shard(i) which must be below nshards. the indices keep their order
+ * within each list. uses nthreads threads.
+ */
+template<class Iterator, class Shard>
+std::vector<std::vector<std::uint32_t>>
+splitshards(Iterator first,
+            Iterator last,
+            std::size_t nshards,
+            std::size_t nthreads,
+            Shard shard)
+{
+  const auto n = static_cast<std::size_t>(last - first);
+  if (nshards == 1) {
+    return { std::vector<std::uint32_t>(first, last) };
+  }
+
+  // each thread splits a piece, then each shard gathers its parts in order
+  std::vector<std::vector<std::vector<std::uint32_t>>> parts(nthreads);
+  inparallel(nthreads, [&](std::size_t t) {
+    parts[t].resize(nshards);
+    const auto begin = static_cast<std::ptrdiff_t>(piecebegin(n, nthreads, t));
+    const auto end = static_cast<std::ptrdiff_t>(piecebegin(n, nthreads, t + 1));
+    for (auto it = first + begin; it != first + end; ++it) {
+      parts[t][shard(*it)].push_back(*it);
+    }
+  });
+  std::vector<std::vector<std::uint32_t>> shards(nshards);
+  inparallel(nthreads, [&](std::size_t t) {
+    for (auto s = t; s < nshards; s += nthreads) {
+      std::size_t size = 0;
+      for (const auto& part : parts) {
+        size += part[s].size();
+      }
+      shards[s].reserve(size);
+      for (auto& part : parts) {
+        shards[s].insert(shards[s].end(), part[s].begin(), part[s].end());
+        std::vector<std::uint32_t>().swap(part[s]);
+      }
+    }
+  });
+  return shards;
+}
+
+/**
+ * hands out files to read to threads, one queue per device. each device has
+ * a limit on how many of its files are read at once, and its files are
+ * handed out in the order they come.
+ */
+class Readqueues
+{
+public:
+  /**
+   * @param order the files, sorted on device
+   * @param device gives the device of a file
+   * @param limit gives the limit for a device
+   */
+  template<class Device, class Limit>
+  Readqueues(const std::vector<std::uint32_t>& order,
+             Device device,
+             Limit limit)
+  {
+    for (std::size_t k = 0; k < order.size(); ++k) {
+      if (k == 0 || device(order[k]) != device(order[k - 1])) {
+        m_queues.push_back(Queue{ k, k, limit(device(order[k])), 0 });
+      }
+      m_queues.back().end = k + 1;
+    }
+  }
+
+  /**
+   * waits until a device with files left has room for another read.
+   * @param k set to the position in order of the file to read
+   * @param queue set to what to give to done() after reading it
+   * @return false if there are no files left
+   */
+  bool take(std::size_t& k, std::size_t& queue)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      while (m_first < m_queues.size() &&
+             m_queues[m_first].next == m_queues[m_first].end) {
+        ++m_first;
+      }
+      if (m_first == m_queues.size()) {
+        return false;
+      }
+      for (queue = m_first; queue < m_queues.size(); ++queue) {
+        Queue& q = m_queues[queue];
+        if (q.next != q.end && q.active < q.limit) {
+          k = q.next++;
+          ++q.active;
+          return true;
+        }
+      }
+      m_wakeup.wait(lock);
+    }
+  }
+
+  /// a file taken from queue is read
+  void done(std::size_t queue)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      --m_queues[queue].active;
+    }
+    m_wakeup.notify_all();
+  }
+
+private:
+  // the files from next up to end are left
+  struct Queue
+  {
+    std::size_t next;
+    std::size_t end;
+    std::size_t limit;
+    std::size_t active;
+  };
+  std::mutex m_mutex;
+  std::condition_variable m_wakeup;
+  std::vector<Queue> m_queues;
+  // the queues before this have no files left
+  std::size_t m_first = 0;
+};
+
+// picks a shard from a hash. the high bits are used, since the low bits
+// pick the slot in a GroupTable, and would all be the same within a shard.
+std::size_t
+shardof(std::uint64_t hash, std::size_t nshards)
+{
+  return (hash >> 32) % nshards;
+}
+
+// the number of shards to group n candidates in on nthreads threads, so each
+// thread gets the same number of them and they are at most GroupTableMaxSize
+std::size_t
+shardsfor(std::size_t n, std::size_t nthreads)
+{
+  const auto pershard = nthreads * GroupTableMaxSize;
+  return nthreads * std::max(std::size_t{ 1 }, (n + pershard - 1) / pershard);
+}
 } // namespace
-int
-Rdutil::sortOnDeviceAndInode()
+
+std::size_t
+Rdutil::threadsfor(std::size_t n) const
+{
+  if (n < ParallelMinSize || m_nthreads <= 1) {
+    return 1;
+  }
+  return std::min(static_cast<std::size_t>(m_nthreads), n / ParallelMinSize);
+}
+
+template<class Function>
+void
+Rdutil::foreachgroup(Function f)
 {
+  // hand out the groups in chunks, so threads which get small groups take
+  // more of them
+  constexpr std::size_t chunk = 256;
+  const auto ngroups = m_groupbegin.size() - 1;
+  std::atomic<std::size_t> next{ 0 };
+  inparallel(threadsfor(m_candidates.size()), [&](std::size_t) {
+    for (;;) {
+      const auto g0 = next.fetch_add(chunk);
+      if (g0 >= ngroups) {
+        break;
+      }
+      const auto g1 = std::min(g0 + chunk, ngroups);
+      for (auto g = g0; g < g1; ++g) {
+        f(g);
+      }
+    }
+  });
+}
 
-  std::sort(m_list.begin(), m_list.end(), cmpDeviceInode);
-  return 0;
+void
+Rdutil::buildtable()
+{
+  if (m_list.size() > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("too many files");
+  }
+  const auto n = m_list.size();
+  m_size.resize(n);
+  m_device.resize(n);
+  m_inode.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    m_size[i] = m_list[i].size();
+    m_device[i] = m_list[i].device();
+    m_inode[i] = m_list[i].inode();
+  }
+  m_candidates.resize(n);
+  std::iota(m_candidates.begin(), m_candidates.end(), std::uint32_t{ 0 });
+  m_groupbegin.assign(1, 0);
+  if (n > 0) {
+    m_groupbegin.push_back(static_cast<std::uint32_t>(n));
+  }
+
+  // rank once, so choosing the best of a group is a plain comparison. the
+  // identity follows the position in the list (see markitems), so the index
+  // breaks ties. the list is usually in ranking order already.
+  struct Rankkey
+  {
+    int cmdline_index;
+    int depth;
+    std::uint32_t index;
+  };
+  std::vector<Rankkey> keys(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    keys[i] = Rankkey{ m_list[i].get_cmdline_index(),
+                       m_list[i].depth(),
+                       static_cast<std::uint32_t>(i) };
+  }
+  const auto cmp = [](const Rankkey& a, const Rankkey& b) {
+    return std::tie(a.cmdline_index, a.depth, a.index) <
+           std::tie(b.cmdline_index, b.depth, b.index);
+  };
+  if (!std::is_sorted(keys.begin(), keys.end(), cmp)) {
+    std::sort(keys.begin(), keys.end(), cmp);
+  }
+  m_rank.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    m_rank[keys[i].index] = static_cast<std::uint32_t>(i);
+  }
+
+  // no checksums have been made for the new table, nor extents asked for
+  m_digests.clear();
+  m_digestlength = 0;
+  m_digestrow.clear();
+  m_extent.clear();
+}
+
+void
+Rdutil::locateextents()
+{
+  // the files are only asked once, even if they are read in several stages
+  if (m_extent.empty()) {
+    m_extent.assign(m_list.size(), NoExtent);
+    const auto n = m_candidates.size();
+    const auto nthreads = std::max(
+      std::size_t{ 1 }, std::min(static_cast<std::size_t>(m_nthreads), n));
+    std::vector<std::size_t> found(nthreads);
+    inparallel(nthreads, [&](std::size_t t) {
+      const auto end = piecebegin(n, nthreads, t + 1);
+      for (auto k = piecebegin(n, nthreads, t); k < end; ++k) {
+        const auto i = m_candidates[k];
+        std::uint64_t physical{};
+        if (firstextent(m_list[i].name().c_str(), physical)) {
+          m_extent[i] = physical;
+          ++found[t];
+        }
+      }
+    });
+    for (const auto f : found) {
+      m_extentsfound += f;
+    }
+  }
+}
+
+std::vector<std::uint32_t>
+Rdutil::readorder()
+{
+  auto order = m_candidates;
+  // the radix sort is stable, so sort on the least significant key first
+  radixsort(order.begin(), order.end(), [this](std::uint32_t i) {
+    return m_inode[i];
+  });
+  if (m_extentorder) {
+    // files without a known extent go last, still in inode order
+    locateextents();
+    radixsort(order.begin(), order.end(), [this](std::uint32_t i) {
+      return m_extent[i];
+    });
+  }
+  radixsort(order.begin(), order.end(), [this](std::uint32_t i) {
+    return m_device[i];
+  });
+  return order;
 }
 
 void
@@ -304,80 +689,228 @@ Rdutil::sort_on_depth_and_name(std::size_t index_of_first)
   assert(index_of_first <= m_list.size());
 
   auto it = std::begin(m_list) + static_cast<std::ptrdiff_t>(index_of_first);
-  std::sort(it, std::end(m_list), cmpDepthName);
+  parallelstablesort(it,
+                     std::end(m_list),
+                     threadsfor(m_list.size() - index_of_first),
+                     cmpDepthName);
 }
 
 std::size_t
 Rdutil::removeIdenticalInodes()
 {
-  // sort list on device and inode.
-  auto cmp = cmpDeviceInode;
-  std::sort(m_list.begin(), m_list.end(), cmp);
-
-  // loop over ranges of adjacent elements
-  using Iterator = decltype(m_list.begin());
-  apply_on_range(
-    m_list.begin(), m_list.end(), cmp, [](Iterator first, Iterator last) {
-      // let the highest-ranking element not be deleted. do this in order, to be
-      // cache friendly.
-      auto best = std::min_element(first, last, cmpRank);
-      std::for_each(first, best, [](Fileinfo& f) { f.setdeleteflag(true); });
-      best->setdeleteflag(false);
-      std::for_each(best + 1, last, [](Fileinfo& f) { f.setdeleteflag(true); });
-    });
+  // find the highest-ranking candidate of each device and inode, in one
+  // pass and without reordering the candidates. the devices and inodes are
+  // split in shards on their hash, and each thread takes its shards one at
+  // a time.
+  using Key = std::pair<unsigned long, unsigned long>;
+  struct Hash
+  {
+    std::uint64_t operator()(const Key& key) const
+    {
+      return mixbits(key.first * 0x9e3779b97f4a7c15ULL ^ key.second);
+    }
+  };
+  const auto nthreads = threadsfor(m_candidates.size());
+  const auto nshards = shardsfor(m_candidates.size(), nthreads);
+  const auto shards = splitshards(m_candidates.begin(),
+                                  m_candidates.end(),
+                                  nshards,
+                                  nthreads,
+                                  [&](std::uint32_t i) {
+                                    return shardof(
+                                      Hash{}(Key{ m_device[i], m_inode[i] }),
+                                      nshards);
+                                  });
+  inparallel(nthreads, [&](std::size_t t) {
+    for (auto s = t; s < nshards; s += nthreads) {
+      GroupTable<Key, std::uint32_t, Hash> best(
+        std::min(shards[s].size(), GroupTableMaxSize));
+      for (const auto i : shards[s]) {
+        auto found = best.insert(Key{ m_device[i], m_inode[i] }, i);
+        if (!found.second && m_rank[i] < m_rank[found.first]) {
+          found.first = i;
+        }
+      }
+
+      // let the highest-ranking element not be deleted.
+      for (const auto i : shards[s]) {
+        m_list[i].setdeleteflag(best.at(Key{ m_device[i], m_inode[i] }) != i);
+      }
+    }
+  });
   return cleanup();
 }
 
 std::size_t
 Rdutil::removeUniqueSizes()
 {
-  // sort list on size
-  auto cmp = cmpSize;
-  std::sort(m_list.begin(), m_list.end(), cmp);
-
-  // loop over ranges of adjacent elements
-  using Iterator = decltype(m_list.begin());
-  apply_on_range(
-    m_list.begin(), m_list.end(), cmp, [](Iterator first, Iterator last) {
-      if (first + 1 == last) {
-        // single element. remove it!
-        first->setdeleteflag(true);
-      } else {
-        // multiple elements. keep them!
-        std::for_each(first, last, [](Fileinfo& f) { f.setdeleteflag(false); });
+  struct Hash
+  {
+    std::uint64_t operator()(std::uint64_t key) const { return mixbits(key); }
+  };
+  using Table = GroupTable<std::uint64_t, std::uint32_t, Hash>;
+  // a size which is not unique, and how many candidates have it
+  using Sizecount = std::pair<std::uint64_t, std::uint32_t>;
+  // a size which is not unique, and where its next candidate goes
+  using Sizepos = std::pair<std::uint64_t, std::uint32_t>;
+
+  std::vector<std::uint32_t> groupbegin{ 0 };
+  std::vector<std::uint32_t> grouped;
+  for (std::size_t g = 0; g + 1 < m_groupbegin.size(); ++g) {
+    const auto first = m_candidates.begin() + m_groupbegin[g];
+    const auto last = m_candidates.begin() + m_groupbegin[g + 1];
+    const auto n = static_cast<std::size_t>(last - first);
+
+    // count the candidates of each size, in one pass without sorting them.
+    // the sizes are split in shards on their hash, and each thread takes
+    // its shards one at a time, so only one small table per thread is kept.
+    const auto nthreads = threadsfor(n);
+    const auto nshards = shardsfor(n, nthreads);
+    const auto shards =
+      splitshards(first, last, nshards, nthreads, [&](std::uint32_t i) {
+        return shardof(Hash{}(static_cast<std::uint64_t>(m_size[i])),
+                       nshards);
+      });
+    std::vector<std::vector<Sizecount>> repeated(nshards);
+    std::vector<std::uint32_t> nunique(nshards);
+    inparallel(nthreads, [&](std::size_t t) {
+      for (auto s = t; s < nshards; s += nthreads) {
+        Table count(std::min(shards[s].size(), GroupTableMaxSize));
+        std::vector<std::uint64_t> sizes;
+        for (const auto i : shards[s]) {
+          const auto size = static_cast<std::uint64_t>(m_size[i]);
+          if (++count.insert(size, 0).first == 2) {
+            sizes.push_back(size);
+          }
+        }
+        nunique[s] = static_cast<std::uint32_t>(shards[s].size());
+        for (const auto size : sizes) {
+          repeated[s].emplace_back(size, count.at(size));
+          nunique[s] -= count.at(size);
+        }
+      }
+    });
+
+    // lay out the sizes which are not unique after each other, smallest
+    // first. there are usually far fewer of them than candidates.
+    std::vector<Sizecount> sizes;
+    for (auto& r : repeated) {
+      sizes.insert(sizes.end(), r.begin(), r.end());
+      std::vector<Sizecount>().swap(r);
+    }
+    parallelstablesort(sizes.begin(),
+                       sizes.end(),
+                       threadsfor(sizes.size()),
+                       [](const Sizecount& a, const Sizecount& b) {
+                         return a.first < b.first;
+                       });
+    std::vector<std::vector<Sizepos>> positions(nshards);
+    auto pos = m_groupbegin[g];
+    for (const auto& size : sizes) {
+      positions[shardof(Hash{}(size.first), nshards)].emplace_back(size.first,
+                                                                   pos);
+      pos += size.second;
+      groupbegin.push_back(pos);
+    }
+    std::vector<Sizecount>().swap(sizes);
+
+    // put the candidates in place. the ones with a unique size are flagged
+    // and go last, in a group of their own which cleanup removes. each size
+    // is in one shard, where the candidates are in their original order.
+    std::vector<std::uint32_t> uniquepos(nshards);
+    for (std::size_t s = 0; s < nshards; ++s) {
+      uniquepos[s] = pos;
+      pos += nunique[s];
+    }
+    grouped.resize(n);
+    inparallel(nthreads, [&](std::size_t t) {
+      for (auto s = t; s < nshards; s += nthreads) {
+        Table next(positions[s].size());
+        for (const auto& size : positions[s]) {
+          next.insert(size.first, size.second);
+        }
+        for (const auto i : shards[s]) {
+          auto* dest = next.find(static_cast<std::uint64_t>(m_size[i]));
+          m_list[i].setdeleteflag(dest == nullptr);
+          if (dest == nullptr) {
+            dest = &uniquepos[s];
+          }
+          grouped[(*dest)++ - m_groupbegin[g]] = i;
+        }
       }
     });
+    std::copy(grouped.begin(), grouped.end(), first);
+    if (groupbegin.back() != m_groupbegin[g + 1]) {
+      groupbegin.push_back(m_groupbegin[g + 1]);
+    }
+  }
+  m_groupbegin.swap(groupbegin);
+
   return cleanup();
 }
 
 std::size_t
 Rdutil::removeUniqSizeAndBuffer()
 {
-  // sort list on size
-  const auto cmp = cmpSize;
-  std::sort(m_list.begin(), m_list.end(), cmp);
-
-  const auto bufcmp = cmpBuffers;
-
-  // loop over ranges of adjacent elements
-  using Iterator = decltype(m_list.begin());
-  apply_on_range(
-    m_list.begin(), m_list.end(), cmp, [&](Iterator first, Iterator last) {
-      // all sizes are equal in [first,last) - sort on buffer content.
-      std::sort(first, last, bufcmp);
+  // where each new group starts. the groups are split independently of
+  // each other, so this is filled in from several threads.
+  std::vector<char> startsgroup(m_candidates.size(), 0);
+
+  withdigestcompare(m_digestlength, [&](auto compare) {
+    const auto bufcmp = [&](std::uint32_t a, std::uint32_t b) {
+      return compare(digest(a), digest(b)) < 0;
+    };
+
+    using Iterator = decltype(m_candidates.begin());
+    foreachgroup([&](std::size_t g) {
+      const auto first = m_candidates.begin() + m_groupbegin[g];
+      const auto last = m_candidates.begin() + m_groupbegin[g + 1];
+
+      // all sizes are equal in [first,last), sort on buffer content. large
+      // groups are sorted on the first eight bytes of the checksum first.
+      if (static_cast<std::size_t>(last - first) >= RadixSortMinSize &&
+          m_digestlength > 0) {
+        radixsort(first, last, [this](std::uint32_t i) {
+          return digestprefix(digest(i), m_digestlength);
+        });
+        if (m_digestlength > 8) {
+          const auto prefixcmp = [this](std::uint32_t a, std::uint32_t b) {
+            return digestprefix(digest(a), m_digestlength) <
+                   digestprefix(digest(b), m_digestlength);
+          };
+          apply_on_range(first, last, prefixcmp, [&](Iterator f, Iterator l) {
+            if (l - f > 1) {
+              std::sort(f, l, bufcmp);
+            }
+          });
+        }
+      } else {
+        std::sort(first, last, bufcmp);
+      }
 
-      // on this set of buffers, find those which are unique
+      // on this set of buffers, find those which are unique. the others
+      // make up a group each.
       apply_on_range(
-        first, last, bufcmp, [](Iterator firstbuf, Iterator lastbuf) {
-          if (firstbuf + 1 == lastbuf) {
-            // we have a unique buffer!
-            firstbuf->setdeleteflag(true);
-          } else {
-            std::for_each(
-              firstbuf, lastbuf, [](Fileinfo& f) { f.setdeleteflag(false); });
+        first, last, bufcmp, [&](Iterator firstbuf, Iterator lastbuf) {
+          const bool unique = firstbuf + 1 == lastbuf;
+          for (auto it = firstbuf; it != lastbuf; ++it) {
+            m_list[*it].setdeleteflag(unique);
           }
+          startsgroup[static_cast<std::size_t>(firstbuf -
+                                               m_candidates.begin())] = 1;
         });
     });
+  });
+
+  m_groupbegin.assign(1, 0);
+  for (std::size_t pos = 1; pos < startsgroup.size(); ++pos) {
+    if (startsgroup[pos]) {
+      m_groupbegin.push_back(static_cast<std::uint32_t>(pos));
+    }
+  }
+  if (!m_candidates.empty()) {
+    m_groupbegin.push_back(static_cast<std::uint32_t>(m_candidates.size()));
+  }
 
   return cleanup();
 }
@@ -385,58 +918,80 @@ Rdutil::removeUniqSizeAndBuffer()
 void
 Rdutil::markduplicates()
 {
-  const auto cmp = cmpSizeThenBuffer;
-  assert(std::is_sorted(m_list.begin(), m_list.end(), cmp));
-
-  // loop over ranges of adjacent elements
-  using Iterator = decltype(m_list.begin());
-  apply_on_range(
-    m_list.begin(),
-    m_list.end(),
-    cmp,
-    [](const Iterator first, const Iterator last) {
-      // size and buffer are equal in  [first,last) - all are duplicates!
-      assert(std::distance(first, last) >= 2);
-
-      // the one with the lowest rank is the original
-      auto orig = std::min_element(first, last, cmpRank);
-      assert(orig != last);
-      // place it first, so later stages will find the original first.
-      std::iter_swap(first, orig);
-      orig = first;
-
-      // make sure they are all duplicates
-      assert(last == find_if_not(first, last, [orig](const Fileinfo& a) {
-               return orig->size() == a.size() && hasEqualBuffers(*orig, a);
-             }));
-
-      // mark the files with the appropriate tag.
-      auto marker = [orig](Fileinfo& elem) {
-        elem.setidentity(-orig->getidentity());
-        if (elem.get_cmdline_index() == orig->get_cmdline_index()) {
-          elem.setduptype(Fileinfo::duptype::DUPTYPE_WITHIN_SAME_TREE);
-        } else {
-          elem.setduptype(Fileinfo::duptype::DUPTYPE_OUTSIDE_TREE);
-        }
-      };
-      orig->setduptype(Fileinfo::duptype::DUPTYPE_FIRST_OCCURRENCE);
-      std::for_each(first + 1, last, marker);
-      assert(first->getduptype() ==
-             Fileinfo::duptype::DUPTYPE_FIRST_OCCURRENCE);
-    });
+  const auto cmprank = [this](std::uint32_t a, std::uint32_t b) {
+    return m_rank[a] < m_rank[b];
+  };
+
+  foreachgroup([&](std::size_t g) {
+    const auto first = m_candidates.begin() + m_groupbegin[g];
+    const auto last = m_candidates.begin() + m_groupbegin[g + 1];
+
+    // size and buffer are equal in  [first,last) - all are duplicates!
+    assert(std::distance(first, last) >= 2);
+
+    // the one with the lowest rank is the original
+    auto orig = std::min_element(first, last, cmprank);
+    assert(orig != last);
+    // place it first, so later stages will find the original first.
+    std::iter_swap(first, orig);
+    const Fileinfo& original = m_list[*first];
+
+    // make sure they are all duplicates
+    assert(last == find_if_not(first, last, [&](std::uint32_t a) {
+             return original.size() == m_list[a].size() &&
+                    Anydigestcompare{ m_digestlength }(digest(*first),
+                                                       digest(a)) == 0;
+           }));
+
+    // mark the files with the appropriate tag.
+    for (auto it = first + 1; it != last; ++it) {
+      Fileinfo& elem = m_list[*it];
+      elem.setidentity(-original.getidentity());
+      if (elem.get_cmdline_index() == original.get_cmdline_index()) {
+        elem.setduptype(Fileinfo::duptype::DUPTYPE_WITHIN_SAME_TREE);
+      } else {
+        elem.setduptype(Fileinfo::duptype::DUPTYPE_OUTSIDE_TREE);
+      }
+    }
+    m_list[*first].setduptype(Fileinfo::duptype::DUPTYPE_FIRST_OCCURRENCE);
+  });
+
+  // the list is only needed in this order from now on. this is the only time
+  // Fileinfo objects are moved.
+  std::vector<Fileinfo> duplicates;
+  duplicates.reserve(m_candidates.size());
+  for (const auto i : m_candidates) {
+    duplicates.push_back(std::move(m_list[i]));
+  }
+  m_list.swap(duplicates);
+  buildtable();
 }
 
 std::size_t
 Rdutil::cleanup()
 {
-  const auto size_before = m_list.size();
-  auto it = std::remove_if(m_list.begin(), m_list.end(), [](const Fileinfo& A) {
-    return A.deleteflag();
-  });
-
-  m_list.erase(it, m_list.end());
+  const auto size_before = m_candidates.size();
+
+  // compact each group, and the groups, in place
+  std::size_t out = 0;
+  std::size_t ngroups = 0;
+  for (std::size_t g = 0; g + 1 < m_groupbegin.size(); ++g) {
+    const auto begin = out;
+    for (auto pos = m_groupbegin[g]; pos != m_groupbegin[g + 1]; ++pos) {
+      const auto i = m_candidates[pos];
+      if (!m_list[i].deleteflag()) {
+        m_candidates[out++] = i;
+      }
+    }
+    if (out != begin) {
+      m_groupbegin[ngroups++] = static_cast<std::uint32_t>(begin);
+    }
+  }
+  m_groupbegin[ngroups++] = static_cast<std::uint32_t>(out);
+  m_groupbegin.resize(ngroups);
+  m_candidates.resize(out);
 
-  const auto size_after = m_list.size();
+  const auto size_after = m_candidates.size();
 
   return size_before - size_after;
 }
@@ -468,13 +1023,14 @@ Rdutil::totalsizeinbytes(int opmode) const
 
   Fileinfo::filesizetype totalsize = 0;
   if (opmode == 0) {
-    for (const auto& elem : m_list) {
-      totalsize += elem.size();
+    for (const auto i : m_candidates) {
+      totalsize += m_size[i];
     }
   } else if (opmode == 1) {
-    for (const auto& elem : m_list) {
-      if (elem.getduptype() == Fileinfo::duptype::DUPTYPE_FIRST_OCCURRENCE) {
-        totalsize += elem.size();
+    for (const auto i : m_candidates) {
+      if (m_list[i].getduptype() ==
+          Fileinfo::duptype::DUPTYPE_FIRST_OCCURRENCE) {
+        totalsize += m_size[i];
       }
     }
   }
@@ -552,11 +1108,11 @@ Rdutil::fillwithbytes(enum Fileinfo::readtobuffermode type,
                       const Options& options,
                       std::function<void(std::size_t)> progress_cb)
 {
-  // first sort on inode (to read efficiently from the hard drive)
-  sortOnDeviceAndInode();
+  // read in inode order, to read efficiently from the hard drive
+  const auto order = readorder();
 
-  // make a checksum object which can be reused to avoid creating an object
-  // per processed file
+  // find the checksum to make. each thread below makes a checksum object
+  // which it reuses, to avoid creating an object per processed file.
   checksumtypes cktype{};
   switch (type) {
     case Fileinfo::readtobuffermode::READ_FIRST_BYTES:
@@ -586,20 +1142,174 @@ Rdutil::fillwithbytes(enum Fileinfo::readtobuffermode type,
 
   Checksum cksum(cktype);
 
+  // make room for the checksums. if the length is the same as before, the
+  // ones of files which are not read again are kept.
+  const auto length = static_cast<std::size_t>(cksum.getDigestLength());
+  if (m_digestrow.empty()) {
+    m_digestrow.assign(m_list.size(), 0);
+    for (std::size_t row = 0; row < m_candidates.size(); ++row) {
+      m_digestrow[m_candidates[row]] = static_cast<std::uint32_t>(row);
+    }
+    m_digests.assign(m_candidates.size() * length, 0);
+    m_digestlength = length;
+  } else if (length != m_digestlength) {
+    const auto rows = m_digests.size() / m_digestlength;
+    m_digests.assign(rows * length, 0);
+    m_digestlength = length;
+  }
+
+  if (m_iouring &&
+      fillwithbytesuring(type, lasttype, cktype, options, order, progress_cb)) {
+    return 0;
+  }
+
+  readinparallel(type, lasttype, cktype, options, order, progress_cb, 0);
+  return 0;
+}
+
+void
+Rdutil::readinparallel(enum Fileinfo::readtobuffermode type,
+                       enum Fileinfo::readtobuffermode lasttype,
+                       checksumtypes cktype,
+                       const Options& options,
+                       const std::vector<std::uint32_t>& order,
+                       const std::function<void(std::size_t)>& progress_cb,
+                       std::size_t progress_count)
+{
   const auto duration = std::chrono::nanoseconds{ options.nsecsleep };
 
-  std::vector<char> buffer(options.buffersize, '\0');
+  // read on several threads, each with a checksum object and buffer of its
+  // own. every device has a queue of its own, in inode order. a rotating
+  // disk is read by one thread at a time, since it would only seek back and
+  // forth between several, while others take as many threads as there are.
+  // each file has a row of its own to write the checksum to.
+  const auto nthreads = std::max(
+    std::size_t{ 1 },
+    std::min(static_cast<std::size_t>(m_nthreads), order.size()));
+  Readqueues queues(
+    order,
+    [this](std::uint32_t i) { return m_device[i]; },
+    [nthreads](dev_t device) {
+      return isrotational(device) ? std::size_t{ 1 } : nthreads;
+    });
+  std::mutex progressmutex;
+
+  inparallel(nthreads, [&](std::size_t) {
+    Checksum workercksum(cktype);
+    std::vector<char> buffer(options.buffersize, '\0');
+    std::size_t k;
+    std::size_t queue;
+    while (queues.take(k, queue)) {
+      if (progress_cb) {
+        std::lock_guard<std::mutex> lock(progressmutex);
+        ++progress_count;
+        progress_cb(progress_count);
+      }
+      const auto i = order[k];
+      m_list[i].fillwithbytes(
+        type, lasttype, buffer, workercksum, options, digest(i));
+      queues.done(queue);
+      if (options.nsecsleep > 0) {
+        std::this_thread::sleep_for(duration);
+      }
+    }
+  });
+}
+
+bool
+Rdutil::fillwithbytesuring(enum Fileinfo::readtobuffermode type,
+                           enum Fileinfo::readtobuffermode lasttype,
+                           checksumtypes cktype,
+                           const Options& options,
+                           const std::vector<std::uint32_t>& order,
+                           const std::function<void(std::size_t)>& progress_cb)
+{
+  // how many files to have in flight, and the most to read from each
+  constexpr unsigned depth = 256;
+  constexpr std::uint64_t maxbytes = 1 << 20;
+
+  std::uint64_t bytes = 0;
+  if (type == Fileinfo::readtobuffermode::READ_FIRST_BYTES) {
+    bytes = options.first_bytes_size;
+  } else if (type == Fileinfo::readtobuffermode::READ_LAST_BYTES) {
+    bytes = options.last_bytes_size;
+  } else {
+    return false;
+  }
+  // sleeping between files is meant to keep the load down
+  if (options.nsecsleep > 0 || bytes > maxbytes) {
+    return false;
+  }
+  UringReader reader(depth, bytes);
+  if (!reader.ok()) {
+    return false;
+  }
+
+  // a rotating disk is read one file at a time, as in fillwithbytes, so its
+  // files are left to readinparallel at the end. the order keeps the files
+  // of a device together.
+  std::vector<char> onrotating(order.size(), 0);
+  for (std::size_t k = 0; k < order.size(); ++k) {
+    const auto device = m_device[order[k]];
+    onrotating[k] = k > 0 && device == m_device[order[k - 1]]
+                      ? onrotating[k - 1]
+                      : isrotational(device);
+  }
+
+  Checksum cksum(cktype);
+  std::vector<char> finished(order.size(), 0);
   std::size_t progress_count = 0;
+  reader.run(
+    order.size(),
+    [&](std::size_t k, UringReader::Request& request) {
+      const Fileinfo& file = m_list[order[k]];
+      if (file.alreadychecksummed(lasttype, cktype, options)) {
+        finished[k] = 1;
+        if (progress_cb) {
+          progress_cb(++progress_count);
+        }
+        return false;
+      }
+      if (onrotating[k]) {
+        return false;
+      }
+      const auto size = static_cast<std::uint64_t>(file.size());
+      request.path = file.name();
+      request.length = bytes;
+      request.offset =
+        type == Fileinfo::readtobuffermode::READ_LAST_BYTES && size > bytes
+          ? size - bytes
+          : 0;
+      return true;
+    },
+    [&](std::size_t k, const unsigned char* data, std::size_t nread) {
+      const auto i = order[k];
+      // less than expected means the file changed since it was found
+      const auto size = static_cast<std::uint64_t>(m_list[i].size());
+      if (data == nullptr || nread != std::min(bytes, size)) {
+        return;
+      }
+      cksum.reset();
+      cksum.update(nread, data);
+      if (cksum.printToBuffer(digest(i), m_digestlength)) {
+        std::cerr << "failed writing digest to buffer!!" << std::endl;
+      }
+      finished[k] = 1;
+      if (progress_cb) {
+        progress_cb(++progress_count);
+      }
+    });
 
-  for (auto& elem : m_list) {
-    if (progress_cb) {
-      ++progress_count;
-      progress_cb(progress_count);
-    }
-    elem.fillwithbytes(type, lasttype, buffer, cksum, options);
-    if (options.nsecsleep > 0) {
-      std::this_thread::sleep_for(duration);
+  // the files which io_uring could not read, or was not used for, are read
+  // as usual, which also reports the ones that can not be opened. they are
+  // still in device and inode order.
+  std::vector<std::uint32_t> rest;
+  for (std::size_t k = 0; k < order.size(); ++k) {
+    if (!finished[k]) {
+      rest.push_back(order[k]);
     }
   }
-  return 0;
+  readinparallel(
+    type, lasttype, cktype, options, rest, progress_cb, progress_count);
+  return true;
 }
@@ -9,6 +9,7 @@
 #ifndef rdutil_hh
 #define rdutil_hh
 
+#include <cstdint>
 #include <functional>
 #include <vector>
 
@@ -24,6 +25,18 @@ public:
   {
   }
 
+  /// sort and group large lists, and read files, with nthreads threads. the
+  /// result is the same for any number of threads.
+  void setnthreads(int nthreads) { m_nthreads = nthreads; }
+
+  /// read the files of a device in order of where their first extent is,
+  /// instead of in inode order. see firstextent().
+  void setextentorder(bool extentorder) { m_extentorder = extentorder; }
+
+  /// read first and last bytes with io_uring, where possible. see
+  /// UringReader.
+  void setiouring(bool iouring) { m_iouring = iouring; }
+
   /**
    * opens the given file for writing and closes it again.
    * @param filename
@@ -38,14 +51,25 @@ public:
    */
   int printtofile(const std::string& filename) const;
 
-  /// mark files with a unique number
-  void markitems();
-
   /**
-   * sorts the list on device and inode. not guaranteed to be stable.
-   * @return
+   * mark files with a unique number. this is when the list is complete, and
+   * the candidate table is built from it. from here on, the sorting and
+   * removal below work on the candidate table and leave the list as it is,
+   * until markduplicates().
+   *
+   * the candidates are kept in groups of files which may still be equal, at
+   * first all in one group. each stage below only splits the groups further
+   * and drops the candidates left alone, so it has work in proportion to the
+   * candidates left and never sorts all of them.
    */
-  int sortOnDeviceAndInode();
+  void markitems();
+
+  /// the number of candidates left
+  std::size_t remaining() const { return m_candidates.size(); }
+
+  /// the number of files where the first extent was found, when reading in
+  /// extent order
+  std::size_t extentsfound() const { return m_extentsfound; }
 
   /**
    * sorts from the given index to the end on depth, then name.
@@ -55,34 +79,37 @@ public:
 
   /**
    * for each group of identical inodes, only keep the one with the highest
-   * rank.
+   * rank. the order of the candidates is kept.
    * @return number of elements removed
    */
   std::size_t removeIdenticalInodes();
 
   /**
-   * remove files with unique size from the list.
-   * @return
+   * splits each group into groups of files with the same size, in order of
+   * increasing size, and removes the files with a unique size.
+   * @return number of elements removed
    */
   std::size_t removeUniqueSizes();
 
   /**
-   * remove files with unique combination of size and buffer from the list.
-   * @return
+   * splits each group into groups of files with the same buffer (the
+   * checksum made by the last fillwithbytes), and removes the files with a
+   * unique buffer within their group.
+   * @return number of elements removed
    */
   std::size_t removeUniqSizeAndBuffer();
 
   /**
-   * Assumes the list is already sorted on size, and all elements with the same
-   * size have the same buffer. Marks duplicates with tags, depending on their
-   * nature. Shall be used when everything is done, and sorted.
-   * For each sequence of duplicates, the original will be placed first but no
+   * Assumes each group holds files that are all equal. Marks duplicates with
+   * tags, depending on their nature. Shall be used when everything is done.
+   * For each group of duplicates, the original will be placed first but no
    * other guarantee on ordering is given.
-   *
+   * The list is then replaced by the remaining candidates, in this order.
    */
   void markduplicates();
 
-  /// removes all items from the list, that have the deleteflag set to true.
+  /// removes all candidates that have the deleteflag set to true, and the
+  /// groups which become empty.
   std::size_t cleanup();
 
   /**
@@ -91,7 +118,9 @@ public:
    */
   std::size_t remove_small_files(Fileinfo::filesizetype minsize);
 
-  // read some bytes. note! destroys the order of the list.
+  // read some bytes. the files are read in device and inode order, which
+  // leaves the groups as they are, on as many threads as set by
+  // setnthreads.
   // if lasttype is supplied, it does not reread files if they are shorter
   // than the file length. (unnecessary!). if -1, feature is turned off.
   // and file is read anyway.
@@ -133,6 +162,103 @@ public:
 
 private:
   std::vector<Fileinfo>& m_list;
+
+  // the most threads to use
+  int m_nthreads = 1;
+
+  // read in order of the first extent of the files
+  bool m_extentorder = false;
+
+  // read first and last bytes with io_uring
+  bool m_iouring = false;
+
+  // how many threads to use on n elements
+  [[gnu::pure]] std::size_t threadsfor(std::size_t n) const;
+
+  // the data the candidates are sorted and grouped on, kept apart from the
+  // list in arrays parallel to it. sorting permutes m_candidates, which is
+  // much cheaper than moving Fileinfo objects around.
+  std::vector<Fileinfo::filesizetype> m_size;
+  std::vector<unsigned long> m_device;
+  std::vector<unsigned long> m_inode;
+  // position in the ranking order, lowest is best. see RANKING in the man
+  // page.
+  std::vector<std::uint32_t> m_rank;
+
+  // the candidates left, as indices in m_list and the arrays above, in their
+  // current order
+  std::vector<std::uint32_t> m_candidates;
+
+  // the groups of candidates, group g being m_candidates from position
+  // m_groupbegin[g] up to m_groupbegin[g+1]. the last element is the end of
+  // the last group, so there is one more element than there are groups.
+  std::vector<std::uint32_t> m_groupbegin;
+
+  // the checksums made by fillwithbytes, m_digestlength bytes each, which is
+  // the length of the digest of the checksum in use. candidate i has row
+  // m_digestrow[i]. rows are handed out to the candidates left when the
+  // first checksum is made.
+  std::vector<unsigned char> m_digests;
+  std::size_t m_digestlength = 0;
+  std::vector<std::uint32_t> m_digestrow;
+
+  // the checksum of candidate i, of length m_digestlength (which is zero
+  // until the first checksum is made)
+  const unsigned char* digest(std::uint32_t i) const
+  {
+    return m_digestlength == 0
+             ? m_digests.data()
+             : m_digests.data() + m_digestrow[i] * m_digestlength;
+  }
+  unsigned char* digest(std::uint32_t i)
+  {
+    return m_digestlength == 0
+             ? m_digests.data()
+             : m_digests.data() + m_digestrow[i] * m_digestlength;
+  }
+
+  // fills the arrays above from m_list, with all of it as candidates in one
+  // group
+  void buildtable();
+
+  // where the first extent of each file is, parallel to m_list. filled in
+  // when it is first needed, with NoExtent where it is not known.
+  std::vector<std::uint64_t> m_extent;
+  static constexpr std::uint64_t NoExtent = ~std::uint64_t{ 0 };
+  std::size_t m_extentsfound = 0;
+
+  // asks for the first extent of the candidates, if not done already
+  void locateextents();
+
+  // the candidates sorted on device and inode (or first extent), the order
+  // to read them in
+  std::vector<std::uint32_t> readorder();
+
+  // reads the files in order, which is sorted on device, on several
+  // threads as fillwithbytes does. progress_cb is called with the count of
+  // files, starting after progress_count.
+  void readinparallel(enum Fileinfo::readtobuffermode type,
+                      enum Fileinfo::readtobuffermode lasttype,
+                      checksumtypes cktype,
+                      const Options& options,
+                      const std::vector<std::uint32_t>& order,
+                      const std::function<void(std::size_t)>& progress_cb,
+                      std::size_t progress_count);
+
+  // the io_uring variant of fillwithbytes, for the first and last bytes.
+  // returns false if io_uring can not be used, and nothing was read. the
+  // files io_uring does not read are left to readinparallel.
+  bool fillwithbytesuring(enum Fileinfo::readtobuffermode type,
+                          enum Fileinfo::readtobuffermode lasttype,
+                          checksumtypes cktype,
+                          const Options& options,
+                          const std::vector<std::uint32_t>& order,
+                          const std::function<void(std::size_t)>& progress_cb);
+
+  // invokes f(g) for every group g, on several threads if there are many
+  // candidates. f must only touch the candidates of group g.
+  template<class Function>
+  void foreachgroup(Function f);
 };
 
 #endif
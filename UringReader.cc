@@ -0,0 +1,403 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+
+#include "config.h"
+
+// std
+#include <algorithm>
+#include <cerrno>
+
+// os
+#ifdef HAVE_IOURING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// project
+#include "UringReader.hh"
+
+#ifdef HAVE_IOURING
+namespace {
+// what a completion is for, kept in the low bits of its user data
+enum Operation : std::uint64_t
+{
+  OPEN = 0,
+  READ = 1,
+  CLOSE = 2,
+};
+
+std::uint64_t
+userdata(unsigned slot, Operation operation)
+{
+  return (std::uint64_t{ slot } << 2) | operation;
+}
+} // namespace
+
+UringReader::UringReader(unsigned depth, std::size_t buffersize)
+  : m_depth(depth)
+  , m_buffersize(buffersize)
+{
+  // the registered buffers are locked in memory and count against
+  // RLIMIT_MEMLOCK (unless the process may lock any amount). leave half of
+  // it to the rest of the process, and keep some for the rounding to pages.
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 &&
+      limit.rlim_cur != RLIM_INFINITY) {
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t allowed = limit.rlim_cur / 2;
+    if (m_buffersize > 0) {
+      const auto fits = allowed > page ? (allowed - page) / m_buffersize : 0;
+      m_depth = static_cast<unsigned>(std::min<std::size_t>(m_depth, fits));
+    }
+  }
+  if (m_depth == 0 || !setup()) {
+    teardown();
+  }
+}
+
+UringReader::~UringReader()
+{
+  teardown();
+}
+
+bool
+UringReader::setup()
+{
+  // three requests per file in flight
+  unsigned entries = 1;
+  while (entries < 3 * m_depth) {
+    entries *= 2;
+  }
+  io_uring_params params{};
+  const long fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) {
+    return false;
+  }
+  m_ringfd = static_cast<int>(fd);
+
+  m_sqringsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_cqringsize =
+    params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool singlemmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singlemmap) {
+    m_sqringsize = m_cqringsize = std::max(m_sqringsize, m_cqringsize);
+  }
+  m_sqring = mmap(nullptr,
+                  m_sqringsize,
+                  PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE,
+                  m_ringfd,
+                  IORING_OFF_SQ_RING);
+  if (m_sqring == MAP_FAILED) {
+    m_sqring = nullptr;
+    return false;
+  }
+  if (singlemmap) {
+    m_cqring = m_sqring;
+  } else {
+    m_cqring = mmap(nullptr,
+                    m_cqringsize,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE,
+                    m_ringfd,
+                    IORING_OFF_CQ_RING);
+    if (m_cqring == MAP_FAILED) {
+      m_cqring = nullptr;
+      return false;
+    }
+  }
+  m_sqessize = params.sq_entries * sizeof(io_uring_sqe);
+  m_sqes = mmap(nullptr,
+                m_sqessize,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE,
+                m_ringfd,
+                IORING_OFF_SQES);
+  if (m_sqes == MAP_FAILED) {
+    m_sqes = nullptr;
+    return false;
+  }
+
+  auto* sq = static_cast<unsigned char*>(m_sqring);
+  auto* cq = static_cast<unsigned char*>(m_cqring);
+  const auto field = [](unsigned char* ring, unsigned offset) {
+    return static_cast<unsigned*>(static_cast<void*>(ring + offset));
+  };
+  m_sqhead = field(sq, params.sq_off.head);
+  m_sqtail = field(sq, params.sq_off.tail);
+  m_sqmask = *field(sq, params.sq_off.ring_mask);
+  m_sqarray = field(sq, params.sq_off.array);
+  m_cqhead = field(cq, params.cq_off.head);
+  m_cqtail = field(cq, params.cq_off.tail);
+  m_cqmask = *field(cq, params.cq_off.ring_mask);
+  m_cqes = cq + params.cq_off.cqes;
+
+  // a slot in the table of direct descriptors, and a buffer, per file in
+  // flight
+  std::vector<int> files(m_depth, -1);
+  if (syscall(__NR_io_uring_register,
+              m_ringfd,
+              IORING_REGISTER_FILES,
+              files.data(),
+              m_depth) < 0) {
+    return false;
+  }
+  m_buffers.resize(m_depth * m_buffersize);
+  iovec buffers{ m_buffers.data(), m_buffers.size() };
+  if (syscall(__NR_io_uring_register,
+              m_ringfd,
+              IORING_REGISTER_BUFFERS,
+              &buffers,
+              1) < 0) {
+    return false;
+  }
+
+  return probe();
+}
+
+bool
+UringReader::probe()
+{
+  // gets the result of the single request in flight
+  const auto result = [this](int& res) {
+    if (!enter(1)) {
+      return false;
+    }
+    const auto* cqes = static_cast<io_uring_cqe*>(m_cqes);
+    const unsigned head = *m_cqhead;
+    if (head == __atomic_load_n(m_cqtail, __ATOMIC_ACQUIRE)) {
+      return false;
+    }
+    res = cqes[head & m_cqmask].res;
+    __atomic_store_n(m_cqhead, head + 1, __ATOMIC_RELEASE);
+    return true;
+  };
+
+  // open the root directory alone. a kernel which can open into direct
+  // descriptors (linux 5.15 and later) gives 0. older ones ignore the slot
+  // and give an ordinary file descriptor, which must not be mistaken for
+  // success: a close of the slot would then close descriptor 0 instead.
+  // that descriptor is only free to be given out if stdin is closed, so do
+  // not try then.
+  if (fcntl(0, F_GETFD) == -1) {
+    return false;
+  }
+  queueopen(0, "/", false);
+  int res = -1;
+  if (!result(res)) {
+    return false;
+  }
+  if (res > 0) {
+    close(res);
+  }
+  if (res != 0) {
+    return false;
+  }
+  queueclose(0);
+  return result(res) && res == 0;
+}
+
+void
+UringReader::teardown()
+{
+  if (m_sqes != nullptr) {
+    munmap(m_sqes, m_sqessize);
+    m_sqes = nullptr;
+  }
+  if (m_cqring != nullptr && m_cqring != m_sqring) {
+    munmap(m_cqring, m_cqringsize);
+  }
+  m_cqring = nullptr;
+  if (m_sqring != nullptr) {
+    munmap(m_sqring, m_sqringsize);
+    m_sqring = nullptr;
+  }
+  if (m_ringfd >= 0) {
+    close(m_ringfd);
+    m_ringfd = -1;
+  }
+}
+
+void
+UringReader::push(const io_uring_sqe& sqe)
+{
+  auto* sqes = static_cast<io_uring_sqe*>(m_sqes);
+  const unsigned tail = *m_sqtail;
+  const unsigned index = tail & m_sqmask;
+  sqes[index] = sqe;
+  m_sqarray[index] = index;
+  __atomic_store_n(m_sqtail, tail + 1, __ATOMIC_RELEASE);
+  ++m_unsubmitted;
+}
+
+void
+UringReader::queueopen(unsigned slot, const char* path, bool link)
+{
+  io_uring_sqe open{};
+  open.opcode = IORING_OP_OPENAT;
+  open.fd = AT_FDCWD;
+  open.addr = reinterpret_cast<std::uintptr_t>(path);
+  open.open_flags = O_RDONLY | O_NOCTTY;
+  open.file_index = slot + 1;
+  open.flags = link ? IOSQE_IO_LINK : 0;
+  open.user_data = userdata(slot, OPEN);
+  push(open);
+}
+
+void
+UringReader::queueclose(unsigned slot)
+{
+  io_uring_sqe closing{};
+  closing.opcode = IORING_OP_CLOSE;
+  closing.file_index = slot + 1;
+  closing.user_data = userdata(slot, CLOSE);
+  push(closing);
+}
+
+void
+UringReader::queue(unsigned slot, const Request& request)
+{
+  // the read only happens if the open worked, the close always
+  queueopen(slot, request.path.c_str(), true);
+
+  io_uring_sqe read{};
+  read.opcode = IORING_OP_READ_FIXED;
+  read.fd = static_cast<int>(slot);
+  read.addr = reinterpret_cast<std::uintptr_t>(m_buffers.data() +
+                                               slot * m_buffersize);
+  read.len = static_cast<unsigned>(std::min(request.length, m_buffersize));
+  read.off = request.offset;
+  read.buf_index = 0;
+  read.flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+  read.user_data = userdata(slot, READ);
+  push(read);
+
+  queueclose(slot);
+}
+
+bool
+UringReader::enter(unsigned mincomplete)
+{
+  for (;;) {
+    const long ret = syscall(__NR_io_uring_enter,
+                             m_ringfd,
+                             m_unsubmitted,
+                             mincomplete,
+                             IORING_ENTER_GETEVENTS,
+                             nullptr,
+                             0);
+    if (ret >= 0) {
+      m_unsubmitted -= static_cast<unsigned>(ret);
+      if (m_unsubmitted == 0) {
+        return true;
+      }
+    } else if (errno != EINTR && errno != EAGAIN) {
+      return false;
+    }
+  }
+}
+
+bool
+UringReader::run(std::size_t count,
+                 const Prepare& prepare,
+                 const Complete& complete)
+{
+  if (!ok()) {
+    return false;
+  }
+
+  struct Slot
+  {
+    Request request;
+    std::size_t file = 0;
+    int pending = 0;
+    bool failed = false;
+    std::size_t nread = 0;
+  };
+  std::vector<Slot> slots(m_depth);
+  std::vector<unsigned> freeslots;
+  for (unsigned slot = m_depth; slot-- > 0;) {
+    freeslots.push_back(slot);
+  }
+
+  std::size_t next = 0;
+  std::size_t inflight = 0;
+  const auto* cqes = static_cast<io_uring_cqe*>(m_cqes);
+  while (next < count || inflight > 0) {
+    while (next < count && !freeslots.empty()) {
+      Slot& slot = slots[freeslots.back()];
+      if (prepare(next, slot.request)) {
+        slot.file = next;
+        slot.pending = 3;
+        slot.failed = false;
+        slot.nread = 0;
+        queue(freeslots.back(), slot.request);
+        freeslots.pop_back();
+        ++inflight;
+      }
+      ++next;
+    }
+    if (inflight == 0) {
+      break;
+    }
+    if (!enter(1)) {
+      return false;
+    }
+
+    unsigned head = *m_cqhead;
+    const unsigned tail = __atomic_load_n(m_cqtail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes[head & m_cqmask];
+      const auto index = static_cast<unsigned>(cqe.user_data >> 2);
+      Slot& slot = slots[index];
+      switch (cqe.user_data & 3) {
+        case OPEN:
+        case READ:
+          if (cqe.res < 0) {
+            slot.failed = true;
+          } else if ((cqe.user_data & 3) == READ) {
+            slot.nread = static_cast<std::size_t>(cqe.res);
+          }
+          break;
+        default:
+          // a failed close of a read only file is of no concern
+          break;
+      }
+      if (--slot.pending == 0) {
+        complete(slot.file,
+                 slot.failed ? nullptr
+                             : m_buffers.data() + index * m_buffersize,
+                 slot.nread);
+        freeslots.push_back(index);
+        --inflight;
+      }
+    }
+    __atomic_store_n(m_cqhead, head, __ATOMIC_RELEASE);
+  }
+  return true;
+}
+
+#else
+
+UringReader::UringReader(unsigned depth, std::size_t buffersize)
+  : m_depth(depth)
+  , m_buffersize(buffersize)
+{
+}
+
+UringReader::~UringReader() = default;
+
+bool
+UringReader::run(std::size_t, const Prepare&, const Complete&)
+{
+  return false;
+}
+
+#endif
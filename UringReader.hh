@@ -0,0 +1,120 @@
+/*
+   Distributed under GPL v 2.0 or later, at your option.
+   See LICENSE for further details.
+*/
+#ifndef RDFIND_URINGREADER_HH_
+#define RDFIND_URINGREADER_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct io_uring_sqe;
+
+/**
+ * Reads a part of many files asynchronously with io_uring, keeping up to
+ * depth files in flight. Each file is opened, read and closed by one linked
+ * chain of requests, into a direct descriptor and a registered buffer, so
+ * the kernel does all three without a round trip to user space in between.
+ *
+ * The ring is driven with the system calls directly, so liburing is not
+ * needed. Only available if HAVE_IOURING is defined, otherwise ok() is
+ * always false.
+ */
+class UringReader
+{
+public:
+  /// what to read from a file: at most length bytes from offset
+  struct Request
+  {
+    std::string path;
+    std::uint64_t offset = 0;
+    std::size_t length = 0;
+  };
+
+  /// called for file k, fills in the request and returns true, or returns
+  /// false to skip the file
+  using Prepare = std::function<bool(std::size_t k, Request& request)>;
+
+  /// called for file k with what was read, or with data null if it could
+  /// not be opened or read
+  using Complete = std::function<
+    void(std::size_t k, const unsigned char* data, std::size_t nread)>;
+
+  /**
+   * sets up a ring for depth files in flight, reading at most buffersize
+   * bytes each. fewer files are kept in flight if the buffers for all of
+   * them would not fit in half of what RLIMIT_MEMLOCK allows to be locked,
+   * since the kernel pins them. this fails if the kernel does not have
+   * io_uring, or it is not allowed, or too old to open files into direct
+   * descriptors, or not even one buffer fits.
+   */
+  UringReader(unsigned depth, std::size_t buffersize);
+  ~UringReader();
+  UringReader(const UringReader&) = delete;
+  UringReader& operator=(const UringReader&) = delete;
+
+  /// true if the ring is set up and can be used
+  bool ok() const { return m_ringfd >= 0; }
+
+  /**
+   * reads files 0...count-1, in order as far as they are started. prepare
+   * and complete are called from the calling thread.
+   * @return false if the ring broke down, and the files which were not
+   * completed yet should be read some other way.
+   */
+  bool run(std::size_t count, const Prepare& prepare, const Complete& complete);
+
+private:
+  int m_ringfd = -1;
+  unsigned m_depth;
+  std::size_t m_buffersize;
+  std::vector<unsigned char> m_buffers;
+
+  // the rings shared with the kernel
+  void* m_sqring = nullptr;
+  std::size_t m_sqringsize = 0;
+  void* m_cqring = nullptr;
+  std::size_t m_cqringsize = 0;
+  void* m_sqes = nullptr;
+  std::size_t m_sqessize = 0;
+  unsigned* m_sqhead = nullptr;
+  unsigned* m_sqtail = nullptr;
+  unsigned m_sqmask = 0;
+  unsigned* m_sqarray = nullptr;
+  unsigned* m_cqhead = nullptr;
+  unsigned* m_cqtail = nullptr;
+  unsigned m_cqmask = 0;
+  void* m_cqes = nullptr;
+
+  // submitted to the ring but not yet told to the kernel
+  unsigned m_unsubmitted = 0;
+
+  // sets up the ring, returns false on failure
+  bool setup();
+  void teardown();
+
+  // checks that opening into a direct descriptor works
+  bool probe();
+
+  // adds sqe to the submission queue
+  void push(const io_uring_sqe& sqe);
+
+  // queues open, read and close of request into direct descriptor slot
+  void queue(unsigned slot, const Request& request);
+
+  // queues the open of path into direct descriptor slot. if link, the next
+  // request only runs if the open worked.
+  void queueopen(unsigned slot, const char* path, bool link);
+
+  // queues the close of direct descriptor slot
+  void queueclose(unsigned slot);
+
+  // tells the kernel about the queued requests, and waits for at least
+  // mincomplete completions. returns false on failure.
+  bool enter(unsigned mincomplete);
+};
+
+#endif /* RDFIND_URINGREADER_HH_ */
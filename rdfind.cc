@@ -10,7 +10,9 @@ static_assert(__cplusplus >= 201703L,
               "this code requires a C++17 capable compiler!");
 
 // std
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -19,7 +21,10 @@ static_assert(__cplusplus >= 201703L,
 #include "CmdlineParser.hh"
 #include "Dirlist.hh"     //to find files
 #include "Fileinfo.hh"    //file container
+#include "FilesFrom.hh"   //to read a list of files
 #include "Options.hh"     //
+#include "PathFilter.hh"  //to skip files and directories by name
+#include "PathStore.hh"   //to keep file names compactly
 #include "RdfindDebug.hh" //debug macro
 #include "Rdutil.hh"      //to do some work
 
@@ -29,6 +34,13 @@ static_assert(__cplusplus >= 201703L,
 std::vector<Fileinfo> filelist;
 const Options* global_options{};
 
+/**
+ * files found by each of the directory walking threads. they are moved over
+ * to filelist once the walk of a command line argument is done, so the
+ * workers never have to synchronize with each other.
+ */
+std::vector<std::vector<Fileinfo>> found_per_worker;
+
 /**
  * this contains the command line index for the path currently
  * being investigated. it has to be global, because function pointers
@@ -38,28 +50,42 @@ int current_cmdline_index = 0;
 
 // function to add items to the list of all files
 static int
-report(const std::string& path, const std::string& name, int depth)
+report(const std::string& path,
+       const std::string& name,
+       int depth,
+       int worker,
+       const struct stat* info)
 {
 
   RDDEBUG("report(" << path.c_str() << "," << name.c_str() << "," << depth
-                    << ")" << std::endl);
-
-  // expand the name if the path is nonempty
-  std::string expandedname = path.empty() ? name : (path + "/" + name);
-
-  Fileinfo tmp(std::move(expandedname), current_cmdline_index, depth);
-  if (tmp.readfileinfo()) {
-    if (tmp.isRegularFile()) {
-      const auto size = tmp.size();
-      if (size >= global_options->minimumfilesize &&
-          size < global_options->maximumfilesize) {
-        filelist.emplace_back(std::move(tmp));
-      }
-    }
-  } else {
+                    << "," << worker << ")" << std::endl);
+
+  // the name is stored compactly, in the shard of this worker, as path +
+  // "/" + name (or just name if the path is empty).
+  const auto w = static_cast<std::size_t>(worker);
+  const auto filename = PathStore::global().add(w, path, name);
+
+  auto& found = found_per_worker[w];
+  if (info) {
+    // the walker already asked the file system, and only reports regular
+    // files within the size limits.
+    found.emplace_back(filename, current_cmdline_index, depth);
+    found.back().setfileinfo(*info);
+    return 0;
+  }
+
+  Fileinfo tmp(filename, current_cmdline_index, depth);
+  if (!tmp.readfileinfo()) {
     std::cerr << "failed to read file info on file \"" << tmp.name() << "\"\n";
     return -1;
   }
+  if (tmp.isRegularFile()) {
+    const auto size = tmp.size();
+    if (size >= global_options->minimumfilesize &&
+        size < global_options->maximumfilesize) {
+      found.emplace_back(std::move(tmp));
+    }
+  }
   return 0;
 }
 
@@ -81,9 +107,26 @@ main(int narg, const char* argv[])
 
   // an object to do sorting and duplicate finding
   Rdutil gswd(filelist);
+  gswd.setnthreads(o.threads);
+  gswd.setextentorder(o.extentorder);
+  gswd.setiouring(o.iouring);
 
   // an object to traverse the directory structure
-  Dirlist dirlist(o.followsymlinks);
+  Dirlist dirlist(o.followsymlinks, o.threads);
+  dirlist.setmaxdepth(o.maxdepth);
+  dirlist.setusegetdents(o.usegetdents);
+  dirlist.setinodeorder(o.inodeorder);
+  dirlist.setonefilesystem(o.onefilesystem);
+  dirlist.setskipdevices(o.skipdevices);
+  dirlist.setsizelimits(o.minimumfilesize, o.maximumfilesize);
+
+  // compile the -include/-exclude rules once, before walking
+  const PathFilter pathfilter(o.pathrules);
+  if (!pathfilter.empty()) {
+    dirlist.setpathfilter(&pathfilter);
+  }
+  found_per_worker.resize(static_cast<std::size_t>(dirlist.nworkers()));
+  PathStore::global().reserveshards(found_per_worker.size());
 
   // this is what function is called when an object is found on
   // the directory traversed by walk. Make sure the pointer to the
@@ -102,6 +145,30 @@ main(int narg, const char* argv[])
     }
   }
 
+  // the file list, if any, comes first.
+  if (!o.filesfrom.empty()) {
+    std::cout << dryruntext << "Now reading the file list \"" << o.filesfrom
+              << "\"";
+    std::cout.flush();
+    std::ifstream listfile;
+    if (o.filesfrom != "-") {
+      listfile.open(o.filesfrom, std::ios_base::in | std::ios_base::binary);
+      if (!listfile.is_open()) {
+        std::cerr << "\ncould not open file list \"" << o.filesfrom << "\"\n";
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    std::istream& in = o.filesfrom == "-" ? std::cin : listfile;
+    const auto nbad = readfilesfrom(in, o.filesfrom_index, o, filelist);
+    std::cout << ", found " << filelist.size() << " files";
+    if (nbad > 0) {
+      std::cout << ", skipped " << nbad
+                << (o.filesfrommeta ? " malformed" : " unreadable")
+                << " records";
+    }
+    std::cout << "." << std::endl;
+  }
+
   // now loop over path list and add the files
 
   // done with arguments. start parsing files and directories!
@@ -121,6 +188,12 @@ main(int narg, const char* argv[])
     std::cout.flush();
     current_cmdline_index = parser.get_current_index();
     dirlist.walk(file_or_dir, 0);
+    for (auto& found : found_per_worker) {
+      filelist.insert(filelist.end(),
+                      std::make_move_iterator(found.begin()),
+                      std::make_move_iterator(found.end()));
+      found.clear();
+    }
     std::cout << ", found " << filelist.size() - lastsize << " files."
               << std::endl;
 
@@ -133,6 +206,25 @@ main(int narg, const char* argv[])
 
   std::cout << dryruntext << "Now have " << filelist.size()
             << " files in total." << std::endl;
+  std::cout << dryruntext << "Avoided " << dirlist.statsavoided()
+            << " stat calls by using the file type from the directory listing."
+            << std::endl;
+  for (std::size_t i = 0; i < pathfilter.size(); ++i) {
+    const auto& rule = pathfilter.rule(i);
+    std::cout << dryruntext << "Rule "
+              << (rule.include ? "-include" : "-exclude")
+              << (rule.isregex ? "regex" : "") << " \"" << rule.pattern
+              << "\" matched " << pathfilter.hits(i) << " times." << std::endl;
+  }
+  if (o.onefilesystem || !o.skipdevices.empty()) {
+    std::cout << dryruntext << "Skipped " << dirlist.devicepruned()
+              << " directories because of their device." << std::endl;
+  }
+  if (o.followsymlinks) {
+    std::cout << dryruntext << "Skipped " << dirlist.revisitspruned()
+              << " directories already walked through another path."
+              << std::endl;
+  }
 
   // mark files with a number for correct ranking. The only ordering at this
   // point is that files found on early command line index are earlier in the
@@ -151,7 +243,7 @@ main(int narg, const char* argv[])
 
   std::cout << dryruntext << "Removed " << gswd.removeUniqueSizes()
             << " files due to unique sizes from list. ";
-  std::cout << filelist.size() << " files left." << std::endl;
+  std::cout << gswd.remaining() << " files left." << std::endl;
 
   // ok. we now need to do something stronger to disambiguate the duplicate
   // candidates. start looking at the contents.
@@ -194,10 +286,10 @@ main(int narg, const char* argv[])
               << it->second << ": " << std::flush;
 
     if (o.showprogress) {
-      progress_callback = []() {
+      progress_callback = [&gswd]() {
         // format the total count only once, not each iteration.
         std::ostringstream oss;
-        oss << "/" << filelist.size() << ")"
+        oss << "/" << gswd.remaining() << ")"
             << "\033[u"; // Restore the cursor to the saved position;
         return [suffix = oss.str()](std::size_t completed) {
           std::cout
@@ -207,19 +299,22 @@ main(int narg, const char* argv[])
       }();
     }
 
-    // read bytes (destroys the sorting, for disk reading efficiency)
+    // read bytes (in inode order, for disk reading efficiency)
     gswd.fillwithbytes(it[0].first, it[-1].first, o, progress_callback);
 
     // remove non-duplicates
     std::cout << "removed " << gswd.removeUniqSizeAndBuffer()
               << " files from list. ";
-    std::cout << filelist.size() << " files left." << std::endl;
+    std::cout << gswd.remaining() << " files left." << std::endl;
+  }
+
+  if (o.extentorder) {
+    std::cout << dryruntext << "Found the first extent of "
+              << gswd.extentsfound() << " files to read." << std::endl;
   }
 
-  // What is left now is a list of duplicates, ordered on size.
-  // We also know the list is ordered on size, then bytes, and all unique
-  // files are gone so it contains sequences of duplicates. Go ahead and mark
-  // them.
+  // What is left now is groups of duplicates, ordered on size, then bytes.
+  // All unique files are gone. Go ahead and mark them.
   gswd.markduplicates();
 
   std::cout << dryruntext << "It seems like you have " << filelist.size()
@@ -0,0 +1,80 @@
+#!/bin/sh
+# Performance test for sorting and grouping many candidates. The files are
+# given with -filesfrommeta, so they do not have to exist and nothing is
+# read from disk, which leaves the time in the sorting.
+# Set RDFIND_BASELINE to another rdfind binary to compare against it, for
+# instance one built from before the candidate table, which sorted the
+# std::vector<Fileinfo> itself (it needs to know -filesfrommeta). The test
+# then fails if rdfind needs more memory at its peak than the baseline.
+# Not meant to be run for regular testing.
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+reset_teststate
+
+TEST_DIR=candidatetable_speedtest
+NFILES=${NFILES:-10000000}
+mkdir -p "$TEST_DIR"
+
+dbgecho "making a list of $NFILES files"
+# unique sizes, so nothing needs to be read, and every tenth file is a
+# hardlink of the one before.
+awk -v n="$NFILES" 'BEGIN {
+  for (i = 1; i <= n; i++) {
+    ino = (i % 10 == 0) ? i - 1 : i
+    size = (i % 10 == 0) ? i - 1 : i
+    printf "%d 1 %d some/long/common/directory/prefix/file%d\n", size, ino, i
+  }
+}' >"$TEST_DIR/list.txt"
+
+# runs binary, and notes the time from when the list is read until the
+# files with unique sizes are removed, which is the sorting and grouping.
+# also notes the resident memory when the list has been read and the peak
+# after the grouping, the difference is what the grouping needed on top
+# of the file list.
+phases() {
+  binary=$1
+  rm -f "$TEST_DIR/fifo"
+  mkfifo "$TEST_DIR/fifo"
+  $binary -threads 1 -filesfrom "$TEST_DIR/list.txt" -filesfrommeta true -makeresultsfile false >"$TEST_DIR/fifo" 2>/dev/null &
+  pid=$!
+  start=0
+  stop=0
+  rss=
+  peak=
+  while IFS= read -r line; do
+    now=$(date +%s%N)
+    case "$line" in
+      *"files in total."*)
+        start=$now
+        rss=$(awk '/^VmRSS/ {print $2}' "/proc/$pid/status" 2>/dev/null || true)
+        ;;
+      *"due to unique sizes"*)
+        stop=$now
+        peak=$(awk '/^VmHWM/ {print $2}' "/proc/$pid/status" 2>/dev/null || true)
+        ;;
+    esac
+  done <"$TEST_DIR/fifo"
+  wait $pid
+  printf '%s\t%d\t%s\t%s\n' "$binary" $(((stop - start) / 1000000)) "$rss" "$peak" >>"$TEST_DIR/phases.tsv"
+}
+
+cat /dev/null >"$TEST_DIR/results.tsv"
+printf 'binary\tgrouping (ms)\tlist read (KiB)\tpeak (KiB)\n' >"$TEST_DIR/phases.tsv"
+for binary in "$rdfind" ${RDFIND_BASELINE:+"$RDFIND_BASELINE"}; do
+  dbgecho "testing $binary"
+  timed "$binary" $binary -threads 1 -filesfrom "$TEST_DIR/list.txt" -filesfrommeta true -makeresultsfile false
+  phases "$binary"
+done
+cat "$TEST_DIR/results.tsv"
+cat "$TEST_DIR/phases.tsv"
+
+if [ -n "$RDFIND_BASELINE" ]; then
+  # the first row after the header is rdfind, the second the baseline
+  if ! awk -F '\t' 'NR == 2 { peak = $4 } NR == 3 { exit !(peak <= $4) }' "$TEST_DIR/phases.tsv"; then
+    echo "rdfind needs more memory than $RDFIND_BASELINE"
+    exit 1
+  fi
+  dbgecho "the peak memory is not above the baseline"
+fi
@@ -73,6 +73,24 @@ verify() {
   fi
 }
 
+# for the speed tests: empties the page cache, so the next run reads from
+# the disk. needs root.
+dropcaches() {
+  sync
+  if ! echo 3 >/proc/sys/vm/drop_caches 2>/dev/null; then
+    dbgecho "could not drop caches, the cold runs are not cold"
+  fi
+}
+
+# for the speed tests: runs the command after the label, and appends the
+# label, elapsed, user and system time (s) and peak memory (KiB) to
+# $TEST_DIR/results.tsv. the label may contain \t to make several columns.
+timed() {
+  label=$1
+  shift
+  /usr/bin/time --append --output="$TEST_DIR/results.tsv" -f "$label\t%e\t%U\t%S\t%M" "$@" >/dev/null 2>&1
+}
+
 # where to mount disorderfs for the determinism tests
 DISORDERED_MNT="$datadir/disordered_mnt"
 DISORDERED_ROOT="$datadir/disordered_root"
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Performance test for listing directories with readdir and getdents.
+# Not meant to be run for regular testing. Needs to run as root to drop the
+# caches before the cold runs.
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+reset_teststate
+
+TEST_DIR=dirreader_speedtest
+NFILES=${NFILES:-1000000}
+
+dbgecho "creating $NFILES files in one directory"
+mkdir -p "$TEST_DIR/huge"
+(
+  cd "$TEST_DIR/huge"
+  seq "$NFILES" | xargs touch
+)
+# a wide and shallow tree too
+for d in $(seq 100); do
+  mkdir -p "$TEST_DIR/tree/$d"
+  (
+    cd "$TEST_DIR/tree/$d"
+    seq 1000 | xargs touch
+  )
+done
+
+cat /dev/null >"$TEST_DIR/results.tsv"
+for dir in huge tree; do
+  for reader in readdir getdents; do
+    dbgecho "testing $reader on $dir"
+    # run twice, the second one with a warm cache
+    for run in cold warm; do
+      if [ "$run" = cold ]; then
+        dropcaches
+      fi
+      timed "$dir\t$reader\t$run" $rdfind -dirreader "$reader" -ignoreempty false -makeresultsfile false "$TEST_DIR/$dir"
+    done
+  done
+done
+cat "$TEST_DIR/results.tsv"
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Performance test for reading files in inode or extent order, with a cold
+# cache, on a file system image aged so that block placement does not follow
+# the inode numbers. Not meant to be run for regular testing. Needs to run as
+# root (to mount the image and drop the caches) and mkfs.ext4, and is only
+# meaningful with the image on a rotating disk (set TMPDIR to somewhere on
+# one).
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+reset_teststate
+
+TEST_DIR=readorder_speedtest
+NFILES=${NFILES:-10000}
+NROUNDS=${NROUNDS:-4}
+CHUNKSIZE=${CHUNKSIZE:-16384}
+IMAGESIZE=${IMAGESIZE:-2G}
+
+mkdir -p "$TEST_DIR/mnt"
+truncate -s "$IMAGESIZE" "$TEST_DIR/image"
+mkfs.ext4 -q -F "$TEST_DIR/image"
+mount -o loop "$TEST_DIR/image" "$TEST_DIR/mnt"
+trap 'umount "$TEST_DIR/mnt"; cleanup' EXIT
+
+# create the files in one order, so the inode numbers follow that, then let
+# them grow a chunk at a time in a new random order each round. every file
+# has the same content as one other file, so all of them are read to the
+# end.
+dbgecho "creating $NFILES files in $NROUNDS rounds"
+mkdir "$TEST_DIR/mnt/files"
+(
+  cd "$TEST_DIR/mnt/files"
+  seq "$NFILES" | xargs touch
+  for round in $(seq "$NROUNDS"); do
+    for f in $(seq "$NFILES" | shuf); do
+      printf "%0${CHUNKSIZE}d" $((f / 2 + round)) >>"$f"
+    done
+    # allocate the blocks of this round before the next one starts
+    sync
+  done
+)
+
+cat /dev/null >"$TEST_DIR/results.tsv"
+for order in inode extent inode extent; do
+  dbgecho "testing $order"
+  dropcaches
+  timed "$order\tcold" $rdfind -readorder "$order" -makeresultsfile false "$TEST_DIR/mnt/files"
+done
+cat "$TEST_DIR/results.tsv"
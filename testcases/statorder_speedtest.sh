@@ -0,0 +1,32 @@
+#!/bin/sh
+# Performance test for examining directory entries in inode or listing
+# order, with a cold cache. Not meant to be run for regular testing. Needs
+# to run as root to drop the caches, and is only meaningful on a rotating
+# disk (set TMPDIR to somewhere on one).
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+reset_teststate
+
+TEST_DIR=statorder_speedtest
+NDIRS=${NDIRS:-200}
+NFILES=${NFILES:-2000}
+
+dbgecho "creating $NDIRS directories with $NFILES files each"
+for d in $(seq "$NDIRS"); do
+  mkdir -p "$TEST_DIR/tree/$d"
+  (
+    cd "$TEST_DIR/tree/$d"
+    # files with content, so d_type alone does not make lstat unnecessary
+    seq "$NFILES" | xargs -n 500 sh -c 'for f; do echo "$f" >"$f"; done' sh
+  )
+done
+
+cat /dev/null >"$TEST_DIR/results.tsv"
+for order in listing inode listing inode; do
+  dbgecho "testing $order"
+  dropcaches
+  timed "$order\tcold" $rdfind -statorder "$order" -ignoreempty false -makeresultsfile false "$TEST_DIR/tree"
+done
+cat "$TEST_DIR/results.tsv"
@@ -0,0 +1,46 @@
+#!/bin/sh
+# Performance test for -threads, on a tree with many small files and a set
+# of large duplicates. Not meant to be run for regular testing. Only
+# meaningful on a machine with several cores. Needs to run as root to drop
+# the caches before the cold runs.
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+reset_teststate
+
+TEST_DIR=threads_speedtest
+NDIRS=${NDIRS:-100}
+NFILES=${NFILES:-3000}
+NLARGE=${NLARGE:-20}
+THREADS=${THREADS:-"1 2 4 $(nproc)"}
+
+dbgecho "creating $NDIRS directories with $NFILES files each"
+for d in $(seq "$NDIRS"); do
+  mkdir -p "$TEST_DIR/tree/$d"
+  (
+    cd "$TEST_DIR/tree/$d"
+    # many different sizes, and some files of the same size and content
+    seq "$NFILES" | xargs -n 500 sh -c 'for f; do seq $((f % 700)) >"$f"; done' sh
+  )
+done
+dbgecho "creating $NLARGE pairs of large duplicates"
+mkdir -p "$TEST_DIR/tree/large"
+for i in $(seq "$NLARGE"); do
+  head -c 50000000 /dev/urandom >"$TEST_DIR/tree/large/$i.a"
+  cp "$TEST_DIR/tree/large/$i.a" "$TEST_DIR/tree/large/$i.b"
+done
+
+cat /dev/null >"$TEST_DIR/results.tsv"
+for threads in $THREADS; do
+  dbgecho "testing $threads threads"
+  dropcaches
+  timed "$threads\tcold" $rdfind -threads "$threads" -outputname "$TEST_DIR/results.$threads" "$TEST_DIR/tree"
+  timed "$threads\twarm" $rdfind -threads "$threads" -outputname "$TEST_DIR/results.$threads" "$TEST_DIR/tree"
+done
+
+# the result must not depend on the number of threads
+for threads in $THREADS; do
+  cmp "$TEST_DIR/results.1" "$TEST_DIR/results.$threads"
+done
+cat "$TEST_DIR/results.tsv"
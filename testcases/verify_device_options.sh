@@ -0,0 +1,68 @@
+#!/bin/sh
+# Ensures that -onefilesystem and -skipdevices work as intended.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+makefiles() {
+  mkdir -p root/sub
+  echo "content" >root/a
+  echo "content" >root/sub/b
+}
+
+reset_teststate
+makefiles
+# everything is on the same file system, so nothing should be skipped
+$rdfind -onefilesystem true root >rdfind.out
+verify grep -q "It seems like you have 2 files that are not unique" rdfind.out
+verify grep -q "Skipped 0 directories" rdfind.out
+# the directory is stat'ed to find its device, so no stat call is avoided
+verify grep -q "Avoided 0 stat calls" rdfind.out
+dbgecho "passed -onefilesystem true test"
+
+reset_teststate
+makefiles
+device=$(stat -c %d root)
+$rdfind -skipdevices "1,$device" root >rdfind.out
+verify grep -q "Now have 0 files in total" rdfind.out
+verify grep -q "Skipped 1 directories" rdfind.out
+dbgecho "passed -skipdevices test"
+
+# a directory on another file system, reached through a symlink
+other=$(mktemp -d /dev/shm/rdfindtestcases.XXXXXXXXXXXX 2>/dev/null || true)
+if [ -z "$other" ]; then
+  dbgecho "no /dev/shm to put a second file system in, skipping"
+elif [ "$(stat -c %d "$other")" = "$(stat -c %d "$datadir")" ]; then
+  rm -rf "$other"
+  dbgecho "/dev/shm is on the same file system, skipping"
+else
+  trap 'rm -rf "$other"; cleanup' EXIT
+  reset_teststate
+  makefiles
+  echo "content" >"$other/c"
+  ln -s "$other" root/link
+  $rdfind -followsymlinks true root >rdfind.out
+  verify grep -q "It seems like you have 3 files that are not unique" rdfind.out
+  verify grep -q ' root/link/c$' results.txt
+
+  $rdfind -followsymlinks true -onefilesystem true root >rdfind.out
+  verify grep -q "It seems like you have 2 files that are not unique" rdfind.out
+  verify grep -q "Skipped 1 directories" rdfind.out
+  verify [ "$(grep -c 'link/' results.txt)" -eq 0 ]
+
+  $rdfind -followsymlinks true -skipdevices "$(stat -c %d "$other")" root >rdfind.out
+  verify grep -q "It seems like you have 2 files that are not unique" rdfind.out
+  verify grep -q "Skipped 1 directories" rdfind.out
+  verify [ "$(grep -c 'link/' results.txt)" -eq 0 ]
+  rm -rf "$other"
+  dbgecho "passed other file system test"
+fi
+
+if $rdfind -skipdevices "1,,2" root >/dev/null 2>&1; then
+  dbgecho "bad device list should have been detected"
+  exit 1
+fi
+dbgecho "passed bad device list test"
+
+dbgecho "all is good for the device options test!"
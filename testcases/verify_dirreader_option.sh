@@ -0,0 +1,41 @@
+#!/bin/sh
+# Ensures that listing directories with getdents gives the same result as
+# with readdir.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+makefiles() {
+  for d in $(seq 0 3); do
+    mkdir -p "dir$d/sub"
+    for f in $(seq 0 200); do
+      echo "content $f" >"dir$d/file$f"
+    done
+    echo "in sub" >"dir$d/sub/file"
+  done
+}
+
+reset_teststate
+makefiles
+$rdfind -dirreader readdir -outputname results_readdir.txt dir* >/dev/null
+# getdents is only skipped if it was left out of the build, any other failure
+# fails the test
+if $rdfind -dirreader getdents -outputname results_getdents.txt dir* >/dev/null 2>getdents.log; then
+  verify cmp results_readdir.txt results_getdents.txt
+  dbgecho "passed same results with getdents test"
+elif grep -q "getdents is not supported on this platform" getdents.log; then
+  dbgecho "getdents not supported, skipping comparison"
+else
+  cat getdents.log
+  dbgecho "getdents failed"
+  exit 1
+fi
+
+if $rdfind -dirreader nonsense dir0 >/dev/null 2>&1; then
+  dbgecho "bad value should have been detected"
+  exit 1
+fi
+dbgecho "passed bad value test"
+
+dbgecho "all is good for the dirreader test!"
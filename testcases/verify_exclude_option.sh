@@ -0,0 +1,48 @@
+#!/bin/sh
+# Ensures that -exclude and -include work as intended.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+makefiles() {
+  mkdir -p root/.git/objects root/src root/node_modules/pkg
+  for f in root/a root/.git/objects/a root/src/a root/node_modules/pkg/a root/src/a.tmp; do
+    echo "same content" >"$f"
+  done
+}
+
+reset_teststate
+makefiles
+$rdfind -exclude .git -exclude node_modules -deleteduplicates true root >rdfind.out
+verify [ -e root/.git/objects/a ]
+verify [ -e root/node_modules/pkg/a ]
+verify [ -e root/a ]
+verify [ ! -e root/src/a ]
+verify [ ! -e root/src/a.tmp ]
+verify grep -q 'Rule -exclude ".git" matched 1 times.' rdfind.out
+dbgecho "passed -exclude test"
+
+reset_teststate
+makefiles
+# the first matching rule decides
+$rdfind -include a.tmp -exclude '*.tmp' -exclude '*/node_modules' -deleteduplicates true root >rdfind.out
+verify [ -e root/node_modules/pkg/a ]
+verify [ ! -e root/src/a.tmp ]
+dbgecho "passed -include test"
+
+reset_teststate
+makefiles
+$rdfind -excluderegex '/(\.git|src)$' -deleteduplicates true root >rdfind.out
+verify [ -e root/.git/objects/a ]
+verify [ -e root/src/a ]
+verify [ ! -e root/node_modules/pkg/a ]
+dbgecho "passed -excluderegex test"
+
+if $rdfind -excluderegex '(' root >/dev/null 2>&1; then
+  dbgecho "bad regex should have been detected"
+  exit 1
+fi
+dbgecho "passed bad regex test"
+
+dbgecho "all is good for the exclude test!"
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Ensures that reading the file list with -filesfrom works as intended.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+makefiles() {
+  mkdir -p "dir with space" other
+  for f in a b "dir with space/c" other/d; do
+    echo "same content" >"$f"
+  done
+}
+
+reset_teststate
+makefiles
+printf 'b\na\ndir with space/c\n' >list.txt
+$rdfind -filesfrom list.txt -deleteduplicates true other >rdfind.out
+# the list ranks higher than the arguments, and in the listed order
+verify [ -e b ]
+verify [ ! -e a ]
+verify [ ! -e "dir with space/c" ]
+verify [ ! -e other/d ]
+dbgecho "passed newline separated test"
+
+reset_teststate
+makefiles
+find . -type f -name '[abc]' -print0 | $rdfind -filesfrom - -nulseparated true >rdfind.out
+verify grep -q "It seems like you have 3 files that are not unique" rdfind.out
+dbgecho "passed NUL separated stdin test"
+
+reset_teststate
+makefiles
+# make the metadata claim different inodes with the same size, rdfind
+# should trust it instead of stat'ing
+size=$(wc -c <a)
+device=$(stat -c %d a)
+printf '%s %s 1 a\n%s %s 2 dir with space/c\n' "$size" "$device" "$size" "$device" >list.txt
+$rdfind -filesfrom list.txt -filesfrommeta true -deleteduplicates true >rdfind.out
+verify [ -e a ]
+verify [ ! -e "dir with space/c" ]
+dbgecho "passed metadata test"
+
+printf 'garbage\n' >list.txt
+$rdfind -filesfrom list.txt -filesfrommeta true >rdfind.out 2>rdfind.err
+verify grep -q "malformed record" rdfind.err
+verify grep -q "skipped 1 malformed records" rdfind.out
+dbgecho "passed malformed record test"
+
+dbgecho "all is good for the filesfrom test!"
@@ -0,0 +1,57 @@
+#!/bin/sh
+# Ensures that reading the first and last bytes with io_uring gives the same
+# result as reading them as usual.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+makefiles() {
+  for d in $(seq 0 3); do
+    mkdir -p "dir$d"
+    # small files, shorter than the first and last bytes
+    for f in $(seq 0 300); do
+      echo "content $((f % 70))" >"dir$d/file$f"
+    done
+    # larger files which differ in the first, the last or no bytes
+    for f in $(seq 0 9); do
+      (
+        echo "first $((f % 2))"
+        head -c10000 </dev/zero
+        echo "last $((f % 3))"
+      ) >"dir$d/large$f"
+    done
+  done
+  # one which can not be read
+  echo "content 1" >unreadable
+  chmod 000 unreadable
+}
+
+reset_teststate
+makefiles
+
+if ! $rdfind -iouring true dir0 >/dev/null 2>rdfind.err; then
+  if grep -q "io_uring is not supported on this platform" rdfind.err; then
+    dbgecho "io_uring is not supported here, skipping"
+    exit 0
+  fi
+  cat rdfind.err
+  exit 1
+fi
+
+for sizes in "-firstbytessize 64 -lastbytessize 64" ""; do
+  # shellcheck disable=SC2086
+  $rdfind $sizes -iouring false -outputname results_sync.txt dir* >/dev/null 2>&1
+  # shellcheck disable=SC2086
+  $rdfind $sizes -iouring true -outputname results_uring.txt dir* >/dev/null 2>&1
+  verify cmp results_sync.txt results_uring.txt
+done
+dbgecho "passed same results test"
+
+# a file which can not be opened is reported as before
+$rdfind -iouring true dir0 unreadable 2>stderr_uring.txt >/dev/null
+$rdfind -iouring false dir0 unreadable 2>stderr_sync.txt >/dev/null
+verify cmp stderr_sync.txt stderr_uring.txt
+dbgecho "passed error message test"
+
+dbgecho "all is good for the iouring test!"
@@ -0,0 +1,49 @@
+#!/bin/sh
+# Ensures deep trees are traversed and that -maxdepth limits the traversal.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+# makes a file at depth 0 and a duplicate of it at depth $1
+makefiles() {
+  echo "deep content" >a
+  deepdir=root
+  for i in $(seq 1 "$1"); do
+    deepdir="$deepdir/d$i"
+  done
+  mkdir -p "$deepdir"
+  echo "deep content" >"$deepdir/b"
+}
+
+#negative value should be reported as misusage
+reset_teststate
+makefiles 1
+if $rdfind -maxdepth -1 a root; then
+  dbgecho "negative value should have been detected"
+  exit 1
+fi
+dbgecho "passed negative value test"
+
+# deeper than the old hard coded recursion limit of 50
+reset_teststate
+makefiles 200
+$rdfind -deleteduplicates true a root >rdfind.out
+verify [ -e a ]
+verify [ ! -e "$deepdir/b" ]
+dbgecho "passed deep tree test"
+
+for limit in 2 3 4; do
+  reset_teststate
+  makefiles 3
+  $rdfind -maxdepth "$limit" -deleteduplicates true a root >rdfind.out
+  verify [ -e a ]
+  if [ "$limit" -lt 3 ]; then
+    verify [ -e "$deepdir/b" ]
+  else
+    verify [ ! -e "$deepdir/b" ]
+  fi
+  dbgecho "passed -maxdepth $limit test"
+done
+
+dbgecho "all is good for the maxdepth test!"
@@ -41,4 +41,37 @@ $rdfind $firstlastoptions -checksum sha1 a* b* \
 
 verify [ "$(cat output.log)" = "It seems like you have 0 files that are not unique" ]
 
+# without any content stage, the files are grouped on size alone. the sizes
+# are not in order on the command line, and only files of the same size may
+# be reported as duplicates of each other.
+reset_teststate
+for n in 1 2 3 4 5 6; do
+  head -c$n </dev/zero >a$n
+  head -c$n </dev/zero >b$n
+done
+$rdfind -firstbytessize 0 -lastbytessize 0 -checksum none \
+  a6 b1 a5 b2 a4 b3 a3 b4 a2 b5 a1 b6 >/dev/null
+verify [ "$(grep -c DUPTYPE_FIRST_OCCURRENCE results.txt)" -eq 6 ]
+verify [ "$(grep -c DUPTYPE_OUTSIDE_TREE results.txt)" -eq 6 ]
+# the size of each file is the number in its name
+verify [ -z "$(awk '!/^#/ && $4 != substr($8, 2)' results.txt)" ]
+
+# files which differ in the first bytes must not end up in the same group of
+# duplicates because their last bytes are equal.
+reset_teststate
+for f in a b; do
+  (
+    printf XXXXXXXX
+    head -c1000 </dev/zero
+  ) >$f
+done
+for f in c d; do
+  (
+    printf YYYYYYYY
+    head -c1000 </dev/zero
+  ) >$f
+done
+$rdfind -firstbytessize 8 -lastbytessize 8 -checksum none a b c d >/dev/null
+verify [ "$(grep -c DUPTYPE_FIRST_OCCURRENCE results.txt)" -eq 2 ]
+
 dbgecho "all is good for the checksum=none test!"
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Ensures that reading files in extent order gives the same result as in
+# inode order.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+makefiles() {
+  for d in $(seq 0 3); do
+    mkdir -p "dir$d"
+    for f in $(seq 0 100); do
+      echo "content $((f % 30))" >"dir$d/file$f"
+    done
+    # larger than the first and last bytes, differing in the middle
+    (
+      head -c10000 </dev/zero
+      echo "middle $((d % 2))"
+      head -c10000 </dev/zero
+    ) >"dir$d/large"
+  done
+}
+
+reset_teststate
+makefiles
+# make sure the files have a place on disk, not only in the page cache
+sync
+
+if ! $rdfind -readorder extent dir0 >rdfind.out 2>rdfind.err; then
+  if grep -q "extent order is not supported on this platform" rdfind.err; then
+    dbgecho "extent order is not supported here, skipping"
+    exit 0
+  fi
+  cat rdfind.err
+  exit 1
+fi
+# the order must have been decided by extents, or the comparison below
+# proves nothing. tmpfs keeps the data in memory and has none.
+if [ "$(stat -f -c %T .)" = tmpfs ]; then
+  dbgecho "no extents on tmpfs, skipping"
+  exit 0
+fi
+verify grep -q "Found the first extent of [1-9][0-9]* files" rdfind.out
+
+for threads in 1 4; do
+  $rdfind -threads $threads -readorder inode -outputname results_inode.txt dir* >/dev/null
+  $rdfind -threads $threads -readorder extent -outputname results_extent.txt dir* >/dev/null
+  verify cmp results_inode.txt results_extent.txt
+done
+dbgecho "passed same results test"
+
+if $rdfind -readorder nonsense dir0 >/dev/null 2>&1; then
+  dbgecho "bad value should have been detected"
+  exit 1
+fi
+dbgecho "passed bad value test"
+
+dbgecho "all is good for the readorder test!"
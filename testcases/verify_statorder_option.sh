@@ -0,0 +1,37 @@
+#!/bin/sh
+# Ensures that examining directory entries in inode order gives the same
+# result as in listing order.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+makefiles() {
+  for d in $(seq 0 3); do
+    mkdir -p "dir$d/sub"
+    for f in $(seq 0 200); do
+      echo "content $((f % 50))" >"dir$d/file$f"
+    done
+    echo "in sub" >"dir$d/sub/file"
+    ln -s file0 "dir$d/link"
+  done
+}
+
+reset_teststate
+makefiles
+for deterministic in true false; do
+  for follow in true false; do
+    $rdfind -deterministic $deterministic -followsymlinks $follow -statorder listing -outputname results_listing.txt dir* >/dev/null
+    $rdfind -deterministic $deterministic -followsymlinks $follow -statorder inode -outputname results_inode.txt dir* >/dev/null
+    verify cmp results_listing.txt results_inode.txt
+  done
+done
+dbgecho "passed same results test"
+
+if $rdfind -statorder nonsense dir0 >/dev/null 2>&1; then
+  dbgecho "bad value should have been detected"
+  exit 1
+fi
+dbgecho "passed bad value test"
+
+dbgecho "all is good for the statorder test!"
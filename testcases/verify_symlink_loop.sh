@@ -0,0 +1,59 @@
+#!/bin/sh
+# Ensures that following symlinks walks every directory once, even with
+# loops and several links to the same directory.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+reset_teststate
+mkdir -p a/b
+echo "same content" >a/file1
+echo "same content" >a/b/file2
+# a loop back to the top, and two more ways into a/b
+ln -s .. a/b/up
+ln -s b a/alias1
+ln -s a/b alias2
+
+$rdfind -followsymlinks true a alias2 >rdfind.out
+# each file is in the results once
+verify [ "$(grep -c 'a/file1$' results.txt)" -eq 1 ]
+verify [ "$(grep -c 'file2$' results.txt)" -eq 1 ]
+verify grep -q "It seems like you have 2 files that are not unique" rdfind.out
+verify grep -q "Skipped 4 directories already walked" rdfind.out
+# a/b is reached as a/alias1 first in byte order, and again from alias2
+verify grep -q ' a/alias1/file2$' results.txt
+verify [ "$(grep -c ' a/b/' results.txt)" -eq 0 ]
+dbgecho "passed loop test"
+
+for threads in 1 4; do
+  $rdfind -followsymlinks true -threads $threads a >rdfind.out
+  verify grep -q "It seems like you have 2 files that are not unique" rdfind.out
+done
+dbgecho "passed threaded loop test"
+
+# many ways into the same directory. the least deep path wins, and of those
+# the first in byte order, whichever thread gets there first.
+reset_teststate
+mkdir -p d/target d/deep/er
+for i in 1 2 3; do
+  echo "content $i" >d/target/file$i
+done
+cp -r d/target d/copy
+for name in link_z link_a link_m link_q link_b; do
+  ln -s target d/$name
+done
+# comes first in byte order, but is deeper
+ln -s ../../target d/deep/er/link_0
+for threads in 1 4 8; do
+  $rdfind -followsymlinks true -threads $threads d >rdfind.out
+  cp results.txt results.$threads
+done
+verify cmp results.1 results.4
+verify cmp results.1 results.8
+verify [ "$(grep -c ' d/link_a/file' results.1)" -eq 3 ]
+verify [ "$(grep -c ' d/copy/file' results.1)" -eq 3 ]
+verify [ "$(grep -c -e link_z -e link_0 -e target results.1)" -eq 0 ]
+dbgecho "passed symlink determinism test"
+
+dbgecho "all is good for the symlink loop test!"
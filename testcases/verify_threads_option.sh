@@ -0,0 +1,62 @@
+#!/bin/sh
+# Ensures that scanning with several threads gives the same result as
+# scanning with one.
+#
+
+set -e
+. "$(dirname "$0")/common_funcs.sh"
+
+# make a tree with duplicates spread over many directories, so the workers
+# have something to steal from each other.
+makefiles() {
+  for d in $(seq 0 7); do
+    for s in $(seq 0 3); do
+      mkdir -p "dir$d/sub$s/deeper"
+      for f in $(seq 0 3); do
+        echo "content $f" >"dir$d/sub$s/file$f"
+        echo "other content $s" >"dir$d/sub$s/deeper/file$f"
+      done
+    done
+  done
+}
+
+#zero threads should be reported as misusage
+reset_teststate
+makefiles
+if $rdfind -threads 0 dir0; then
+  dbgecho "zero threads should have been detected"
+  exit 1
+fi
+dbgecho "passed zero threads test"
+
+reset_teststate
+makefiles
+$rdfind -threads 1 -outputname results1.txt dir* | grep -v "results file" >rdfind1.out
+for threads in 2 4 16; do
+  $rdfind -threads "$threads" -outputname "results$threads.txt" dir* \
+    | grep -v "results file" >"rdfind$threads.out"
+  verify cmp results1.txt "results$threads.txt"
+  verify cmp rdfind1.out "rdfind$threads.out"
+done
+dbgecho "passed same results regardless of thread count test"
+
+# the sorting and grouping only uses several threads on large lists. make
+# one from a file list with the metadata given, so nothing needs to exist.
+reset_teststate
+awk 'BEGIN {
+  for (i = 1; i <= 200000; i++) {
+    size = (i * 7919) % 120000 + 1
+    inode = (i * 104729) % 150000
+    printf "%d %d %d dir%d/file%d\n", size, i % 3, inode, i % 97, i
+  }
+}' >list.txt
+for threads in 1 4; do
+  $rdfind -threads "$threads" -filesfrom list.txt -filesfrommeta true \
+    -firstbytessize 0 -lastbytessize 0 -checksum none \
+    -outputname "results$threads.txt" | grep -v "results file" >"rdfind$threads.out"
+done
+verify cmp results1.txt results4.txt
+verify cmp rdfind1.out rdfind4.out
+dbgecho "passed same results regardless of thread count on a large list"
+
+dbgecho "all is good for the threads test!"
@@ -87,3 +87,61 @@ TEST_CASE("-minsize 1234 -ignoreempty false")
   Options o = parseOptions(parser);
   REQUIRE(o.minimumfilesize == 0);
 }
+
+TEST_CASE("one thread by default")
+{
+  Options defaults;
+  REQUIRE(defaults.threads == 1);
+}
+
+TEST_CASE("-threads 8")
+{
+  const int argc = 3;
+  const char* argv[argc] = { "progname", "-threads", "8" };
+  Parser parser(argc, argv);
+
+  Options o = parseOptions(parser);
+  REQUIRE(o.threads == 8);
+}
+
+TEST_CASE("-maxdepth 0")
+{
+  const int argc = 3;
+  const char* argv[argc] = { "progname", "-maxdepth", "0" };
+  Parser parser(argc, argv);
+
+  Options o = parseOptions(parser);
+  REQUIRE(o.maxdepth == 0);
+}
+
+TEST_CASE("readdir by default")
+{
+  Options defaults;
+  REQUIRE_FALSE(defaults.usegetdents);
+}
+
+TEST_CASE("-skipdevices 1,23")
+{
+  const int argc = 3;
+  const char* argv[argc] = { "progname", "-skipdevices", "1,23" };
+  Parser parser(argc, argv);
+
+  Options o = parseOptions(parser);
+  REQUIRE(o.skipdevices == std::vector<dev_t>{ 1, 23 });
+}
+
+TEST_CASE("-exclude and -include keep their order")
+{
+  const int argc = 5;
+  const char* argv[argc] = {
+    "progname", "-include", "keep", "-exclude", ".git"
+  };
+  Parser parser(argc, argv);
+
+  Options o = parseOptions(parser);
+  REQUIRE(o.pathrules.size() == 2);
+  REQUIRE(o.pathrules[0].include);
+  REQUIRE(o.pathrules[0].pattern == "keep");
+  REQUIRE_FALSE(o.pathrules[1].include);
+  REQUIRE(o.pathrules[1].pattern == ".git");
+}
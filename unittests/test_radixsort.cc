@@ -0,0 +1,103 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "RadixSort.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<std::uint64_t>
+randomkeys(std::size_t n, std::uint64_t max)
+{
+  std::mt19937_64 rng(n);
+  std::uniform_int_distribution<std::uint64_t> dist(0, max);
+  std::vector<std::uint64_t> keys(n);
+  for (auto& k : keys) {
+    k = dist(rng);
+  }
+  return keys;
+}
+
+std::vector<std::uint32_t>
+iota(std::size_t n)
+{
+  std::vector<std::uint32_t> v(n);
+  std::iota(v.begin(), v.end(), std::uint32_t{ 0 });
+  return v;
+}
+} // namespace
+
+TEST_CASE("radixsort sorts like std::stable_sort")
+{
+  for (const std::size_t n : { std::size_t{ 0 },
+                               std::size_t{ 10 },
+                               RadixSortMinSize - 1,
+                               RadixSortMinSize,
+                               std::size_t{ 100000 } }) {
+    for (const std::uint64_t max : { std::uint64_t{ 3 },
+                                     std::uint64_t{ 1000000 },
+                                     ~std::uint64_t{ 0 } }) {
+      const auto keys = randomkeys(n, max);
+      const auto key = [&keys](std::uint32_t i) { return keys[i]; };
+      auto expected = iota(n);
+      std::stable_sort(
+        expected.begin(), expected.end(), [&](std::uint32_t a, std::uint32_t b) {
+          return keys[a] < keys[b];
+        });
+      auto actual = iota(n);
+      radixsort(actual.begin(), actual.end(), key);
+      REQUIRE(actual == expected);
+    }
+  }
+}
+
+TEST_CASE("radixsort on two keys, least significant first")
+{
+  const std::size_t n = 50000;
+  const auto major = randomkeys(n, 10);
+  const auto minor = randomkeys(n + 1, 1000);
+  auto indices = iota(n);
+  radixsort(indices.begin(), indices.end(), [&](std::uint32_t i) {
+    return minor[i];
+  });
+  radixsort(indices.begin(), indices.end(), [&](std::uint32_t i) {
+    return major[i];
+  });
+  REQUIRE(std::is_sorted(
+    indices.begin(), indices.end(), [&](std::uint32_t a, std::uint32_t b) {
+      return std::make_pair(major[a], minor[a]) <
+             std::make_pair(major[b], minor[b]);
+    }));
+}
+
+// run with: test_radixsort "[.benchmark]"
+// shows where radixsort gets faster than std::sort, to set
+// RadixSortMinSize.
+TEST_CASE("radixsort versus std::sort", "[.benchmark]")
+{
+  const std::size_t sizes[] = { 256, 1024, 2048, 4096, 65536, 1 << 20 };
+  for (const std::size_t n : sizes) {
+    const auto keys = randomkeys(n, std::uint64_t{ 1 } << 40);
+    const auto unsorted = iota(n);
+    const auto key = [&keys](std::uint32_t i) { return keys[i]; };
+    BENCHMARK("std::sort " + std::to_string(n))
+    {
+      auto v = unsorted;
+      std::sort(v.begin(), v.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return keys[a] < keys[b];
+      });
+      return v;
+    };
+    BENCHMARK("radixsort " + std::to_string(n))
+    {
+      auto v = unsorted;
+      radixsort(v.begin(), v.end(), key);
+      return v;
+    };
+  }
+}